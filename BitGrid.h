@@ -0,0 +1,94 @@
+#ifndef BITGRID_H
+#define BITGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "CaveGrid.h"
+using namespace std;
+
+//Bit-packed grid storing 64 cells per word, least significant bit first.
+//Each row is padded with a zero guard word on either side so word-level
+//kernels can read their west and east neighbours without bounds checks.
+class BitGrid {
+public:
+  BitGrid() : width(0), height(0), wordsPerRow(0), stride(0) {}
+  BitGrid(int _width, int _height) { resize(_width, _height); }
+
+  //Resizes the grid and clears every bit.
+  void resize(int _width, int _height) {
+    width = _width;
+    height = _height;
+    wordsPerRow = (width + 63) / 64;
+    stride = wordsPerRow + 2;
+    words.assign((size_t)stride * height, 0);
+  }
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  int getWordsPerRow() const { return wordsPerRow; }
+  int getStride() const { return stride; }
+
+  //First data word of a row. row(y)[-1] and row(y)[getWordsPerRow()] are guard words.
+  uint64_t* row(int y) { return words.data() + (size_t)y * stride + 1; }
+  const uint64_t* row(int y) const { return words.data() + (size_t)y * stride + 1; }
+
+  bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+  void set(int x, int y, bool value) {
+    uint64_t bit = (uint64_t)1 << (x & 63);
+    if (value) { row(y)[x >> 6] |= bit; } else { row(y)[x >> 6] &= ~bit; }
+  }
+
+  //Sets a bit for every cell in the cave equal to the given value.
+  void pack(const CaveGrid& cave, uint8_t value) {
+    if (cave.getWidth() != width || cave.getHeight() != height) {
+      resize(cave.getWidth(), cave.getHeight());
+    }
+    for (int y = 0; y < height; y++) {
+      const uint8_t* src = cave.row(y);
+      uint64_t* dst = row(y);
+      for (int k = 0; k < wordsPerRow; k++) {
+        int end = (k + 1) * 64 < width ? 64 : width - k * 64;
+        uint64_t word = 0;
+        for (int i = 0; i < end; i++) {
+          word |= (uint64_t)(src[k * 64 + i] == value) << i;
+        }
+        dst[k] = word;
+      }
+    }
+  }
+
+  //Writes setValue to cells whose bit is set and clearValue to the rest.
+  void unpack(CaveGrid& cave, uint8_t setValue, uint8_t clearValue) const {
+    if (cave.getWidth() != width || cave.getHeight() != height) {
+      cave.resize(width, height, clearValue);
+    }
+    for (int y = 0; y < height; y++) {
+      const uint64_t* src = row(y);
+      uint8_t* dst = cave.row(y);
+      for (int x = 0; x < width; x++) {
+        dst[x] = ((src[x >> 6] >> (x & 63)) & 1) ? setValue : clearValue;
+      }
+    }
+  }
+
+  //Mask of the bits in word k that lie within the columns [x0, x1).
+  static uint64_t columnMask(int k, int x0, int x1) {
+    int lo = x0 - k * 64;
+    int hi = x1 - k * 64;
+    if (lo < 0) { lo = 0; }
+    if (hi > 64) { hi = 64; }
+    if (hi <= lo) { return 0; }
+    uint64_t upper = (hi == 64) ? ~(uint64_t)0 : (((uint64_t)1 << hi) - 1);
+    return upper & ~(((uint64_t)1 << lo) - 1);
+  }
+
+private:
+  int width;
+  int height;
+  int wordsPerRow;
+  int stride;
+  vector<uint64_t> words;
+};
+
+#endif
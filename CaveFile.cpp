@@ -0,0 +1,182 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "CaveFile.h"
+#include "MapCell.h"
+using namespace std;
+
+const uint32_t CaveFile::version;
+
+CaveFile::CaveFile() : mapping(nullptr), mappingSize(0), header(nullptr), words(nullptr) {}
+
+CaveFile::~CaveFile() {
+	close();
+}
+
+//Maps a cave file into memory, returning false if it is missing, truncated or from another version.
+bool CaveFile::open(const string &path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CaveFileHeader)) {
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) { return false; }
+	mapping = data;
+	mappingSize = info.st_size;
+
+	//Checks the header describes a grid that fits in the file.
+	const CaveFileHeader* h = (const CaveFileHeader*)mapping;
+	bool valid = memcmp(h->magic, "CAVE", 4) == 0 && h->version == version && h->width > 0 && h->height > 0
+		&& h->wordsPerRow == (uint32_t)((h->width + 63) / 64)
+		&& mappingSize >= sizeof(CaveFileHeader) + (size_t)h->wordsPerRow * h->height * sizeof(uint64_t)
+		&& h->startX >= 0 && h->startX < h->width && h->startY >= 0 && h->startY < h->height;
+	if (!valid) {
+		close();
+		return false;
+	}
+	header = h;
+	words = (const uint64_t*)((const char*)mapping + sizeof(CaveFileHeader));
+	return true;
+}
+
+void CaveFile::close() {
+	if (mapping) { munmap(mapping, mappingSize); }
+	mapping = nullptr;
+	mappingSize = 0;
+	header = nullptr;
+	words = nullptr;
+}
+
+//Checks the file was generated from the given parameters.
+bool CaveFile::matches(const CaveParams &params) const {
+	return header && header->width == params.width && header->height == params.height
+		&& header->offsetX == params.offsetX && header->offsetY == params.offsetY
+		&& header->fillPercentage == params.fillPercentage && header->noiseScale == params.noiseScale
+		&& header->smoothIterations == params.smoothIterations && header->seed == params.seed
+		&& header->octaves == params.octaves && header->lacunarity == params.lacunarity
+		&& header->persistence == params.persistence && header->ruleRadius == params.ruleRadius
+		&& header->ruleHash == ruleHash(params.rule);
+}
+
+const CaveFileHeader& CaveFile::getHeader() const {
+	return *header;
+}
+
+Cell CaveFile::getStartCell() const {
+	return Cell(header->startX, header->startY);
+}
+
+//Reads a cell straight from the mapped grid.
+bool CaveFile::isFree(int x, int y) const {
+	return (words[(size_t)y * header->wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+}
+
+//Expands the mapped grid into a cave of free and occupied cells.
+void CaveFile::unpack(CaveGrid &cave) const {
+	const int width = header->width;
+	const int height = header->height;
+	cave.resize(width, height, Occupied);
+	for (int y = 0; y < height; y++) {
+		const uint64_t* rowWords = words + (size_t)y * header->wordsPerRow;
+		uint8_t* row = cave.row(y);
+		for (int x = 0; x < width; x++) {
+			row[x] = ((rowWords[x >> 6] >> (x & 63)) & 1) ? Free : Occupied;
+		}
+	}
+}
+
+//Writes a cave file. The file is written under a temporary name and renamed into place,
+//so a reader never maps a partially written file.
+bool CaveFile::save(const string &path, const CaveParams &params, const CaveGrid &cave, Cell startCell, int startCount) {
+	CaveFileHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "CAVE", 4);
+	h.version = version;
+	h.width = cave.getWidth();
+	h.height = cave.getHeight();
+	h.offsetX = params.offsetX;
+	h.offsetY = params.offsetY;
+	h.fillPercentage = params.fillPercentage;
+	h.noiseScale = params.noiseScale;
+	h.smoothIterations = params.smoothIterations;
+	h.octaves = params.octaves;
+	h.lacunarity = params.lacunarity;
+	h.persistence = params.persistence;
+	h.seed = params.seed;
+	h.startX = startCell.x;
+	h.startY = startCell.y;
+	h.startCount = startCount;
+	h.wordsPerRow = (h.width + 63) / 64;
+	h.ruleHash = ruleHash(params.rule);
+	h.ruleRadius = params.ruleRadius;
+
+	//Packs the free cells of each row.
+	vector<uint64_t> grid((size_t)h.wordsPerRow * h.height, 0);
+	for (int y = 0; y < h.height; y++) {
+		const uint8_t* row = cave.row(y);
+		uint64_t* rowWords = grid.data() + (size_t)y * h.wordsPerRow;
+		for (int x = 0; x < h.width; x++) {
+			if (row[x] == Free) { rowWords[x >> 6] |= 1ULL << (x & 63); }
+		}
+	}
+
+	string temporary = path + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (!file) { return false; }
+	bool written = fwrite(&h, sizeof(h), 1, file) == 1 && fwrite(grid.data(), sizeof(uint64_t), grid.size(), file) == grid.size();
+	written = (fclose(file) == 0) && written;
+	if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+//FNV-1a over raw bytes, continuing from a previous hash.
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t CaveFile::ruleHash(const string &rule) {
+	return fnv1a(rule.data(), rule.size());
+}
+
+//FNV-1a hash of the dimensions and cells of a cave, identifying the exact cave files derived from it were built for.
+uint64_t CaveFile::gridHash(const CaveGrid &cave) {
+	const int32_t size[] = { cave.getWidth(), cave.getHeight() };
+	return fnv1a(cave.data(), cave.size(), fnv1a(size, sizeof(size)));
+}
+
+//FNV-1a hash of the parameter tuple a cave is generated from, along with the generator version.
+uint64_t CaveFile::paramsHash(const CaveParams &params) {
+	const uint32_t key[] = { version, (uint32_t)params.width, (uint32_t)params.height, (uint32_t)params.smoothIterations, (uint32_t)params.octaves, (uint32_t)params.ruleRadius };
+	const float values[] = { params.offsetX, params.offsetY, params.fillPercentage, params.noiseScale, params.lacunarity, params.persistence };
+	const uint64_t rule = ruleHash(params.rule);
+
+	//Hashes the raw bytes of the tuple.
+	uint64_t hash = fnv1a(key, sizeof(key));
+	hash = fnv1a(values, sizeof(values), hash);
+	hash = fnv1a(&params.seed, sizeof(params.seed), hash);
+	return fnv1a(&rule, sizeof(rule), hash);
+}
+
+//Path of the cached cave for a set of parameters, named by a hash of the parameter tuple.
+//The header is checked with matches() on load, so hash collisions only cost a regeneration.
+string CaveFile::cachePath(const string &directory, const CaveParams &params) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cave", (unsigned long long)paramsHash(params));
+	return directory + "/" + name;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "CaveGrid.h"
+#include "CaveGenerator.h"
+#include "Cell.h"
+using namespace std;
+
+//Fixed 88 byte header at the start of a cave file, followed by the bit-packed grid.
+//The grid holds one bit per cell (set when free), 64 cells per little-endian word with the
+//lowest bit first, and wordsPerRow words for each row from y = 0 upwards.
+struct CaveFileHeader {
+  char magic[4]; //"CAVE".
+  uint32_t version; //Format and generator version, files from other versions are ignored.
+  int32_t width;
+  int32_t height;
+  float offsetX;
+  float offsetY;
+  float fillPercentage;
+  float noiseScale;
+  int32_t smoothIterations;
+  int32_t octaves;
+  float lacunarity;
+  float persistence;
+  uint64_t seed;
+  int32_t startX;
+  int32_t startY;
+  int32_t startCount;
+  uint32_t wordsPerRow;
+  uint64_t ruleHash; //FNV-1a hash of the cellular automata rule string.
+  int32_t ruleRadius;
+  uint32_t reserved;
+};
+static_assert(sizeof(CaveFileHeader) == 88, "Cave file header must stay 88 bytes, keeping the grid 8 byte aligned");
+
+//Read-only view of a cave file mapped into memory with mmap.
+//The header and grid are used in place, so opening a file costs only the page faults it touches.
+class CaveFile {
+public:
+  static const uint32_t version = 2;
+  CaveFile();
+  ~CaveFile();
+  bool open(const string &path);
+  void close();
+  bool matches(const CaveParams &params) const;
+  const CaveFileHeader& getHeader() const;
+  Cell getStartCell() const;
+  bool isFree(int x, int y) const;
+  void unpack(CaveGrid &cave) const;
+  static bool save(const string &path, const CaveParams &params, const CaveGrid &cave, Cell startCell, int startCount);
+  static uint64_t paramsHash(const CaveParams &params);
+  static string cachePath(const string &directory, const CaveParams &params);
+  static uint64_t ruleHash(const string &rule);
+  static uint64_t gridHash(const CaveGrid &cave);
+private:
+  CaveFile(const CaveFile&);
+  CaveFile& operator=(const CaveFile&);
+  void* mapping;
+  size_t mappingSize;
+  const CaveFileHeader* header;
+  const uint64_t* words;
+};
@@ -0,0 +1,229 @@
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "CaveGenerator.h"
+#include "CellularAutomata.h"
+#include "SimplexNoise.h"
+#include "MapCell.h"
+using namespace std;
+
+const int CaveGenerator::border;
+const int CaveGenerator::stageCount;
+
+CaveGenerator::CaveGenerator() : startCount(0), freeComponentCount(0), largestComponentSize(0) {}
+
+//Seconds elapsed since the given time, which is then moved on to now.
+static double lap(chrono::steady_clock::time_point &since) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(now - since).count();
+	since = now;
+	return seconds;
+}
+
+//Runs every generation stage, optionally timing each one and measuring the cave.
+//Progress, when given, is advanced after each stage. Returns false if it was cancelled
+//before the last stage finished, leaving the cave incomplete.
+bool CaveGenerator::generate(const CaveParams &params, CaveMetrics *metrics, CaveProgress *progress) {
+	CaveMetrics unused;
+	CaveMetrics &m = metrics ? *metrics : unused;
+	CaveProgress idle;
+	CaveProgress &p = progress ? *progress : idle;
+	chrono::steady_clock::time_point time = chrono::steady_clock::now();
+
+	p.stage = 0;
+	randomise(params); //Uses simplex noise to create a random cave.
+	m.randomiseTime = lap(time);
+	if (p.cancelled) { return false; }
+	p.stage = 1;
+	m.convergedIteration = smooth(params); //Uses cellular automata to smooth the cave cells.
+	m.smoothTime = lap(time);
+	if (p.cancelled) { return false; }
+	p.stage = 2;
+	findStartCell(params); //Finds an appropraite starting location.
+	m.startTime = lap(time);
+	if (p.cancelled) { return false; }
+	p.stage = 3;
+	m.removedFreePockets = fillInaccessibleAreas(); //Removes inaccessible free cells.
+	m.fillTime = lap(time);
+	if (p.cancelled) { return false; }
+	p.stage = 4;
+	m.removedOccupiedPockets = 0;
+	if (params.smoothIterations % 2 == 0) {
+		m.removedOccupiedPockets = removeNonBorderOccupiedAreas(params); //Removes occupied cells not connected to the cave border.
+	}
+	m.removeTime = lap(time);
+	p.stage = stageCount;
+
+	if (metrics) {
+		m.freeComponents = freeComponentCount;
+		m.largestComponent = largestComponentSize;
+		m.freeCells = 0;
+		const uint8_t* cells = cave.data();
+		for (size_t i = 0; i < cave.size(); i++) {
+			m.freeCells += (cells[i] == Free);
+		}
+	}
+	return true;
+}
+
+//Name of the stage a run is in once the given number of stages have completed.
+const char* CaveGenerator::stageName(int stage) {
+	static const char* names[stageCount + 1] = {"Noise", "Smoothing", "Finding Start", "Filling", "Removing Pockets", "Done"};
+	return names[max(0, min(stage, stageCount))];
+}
+
+//Generates the initial cave using Simplex noise.
+void CaveGenerator::randomise(const CaveParams &params) {
+
+	//Allocates the cave at the requested dimensions, starting with every cell occupied (the border).
+	cave.resize(params.width, params.height, Occupied);
+	fillNoise(cave, 0, 0, border, params.width - border, border, params.height - border, params);
+}
+
+//Thresholds the noise field into free and occupied cells over [x0, x1) x [y0, y1) of a grid
+//whose cell (0,0) lies at (originX, originY) in the noise field. Noise coordinates are scaled
+//by the cave dimensions of the parameters, so any grid covering the same cells matches the cave.
+//A non-zero seed gives the noise its own permutation table, so the cave can be sampled near the origin.
+void CaveGenerator::fillNoise(CaveGrid &cells, int originX, int originY, int x0, int x1, int y0, int y1, const CaveParams &params) {
+	if (x1 <= x0 || y1 <= y0) { return; }
+
+	//Thresholds the noise value into either a free or occupied cell.
+	const float noiseThreshold = (params.fillPercentage / 50.0f) - 1.0f;
+	const int rowWidth = x1 - x0;
+
+	//Maps each x coordinate to a scaled and offset coordinate, shared by every row.
+	vector<float> mappedX(rowWidth);
+	vector<float> noiseValues(rowWidth);
+	for (int x = x0; x < x1; x++) {
+		mappedX[x - x0] = (float)(originX + x) / params.width * params.noiseScale + params.offsetX;
+	}
+
+	//Fractal noise sums every octave of a row in one pass.
+	SimplexNoise noise = params.seed ? SimplexNoise(1.0f, 1.0f, params.lacunarity, params.persistence, params.seed) : SimplexNoise(1.0f, 1.0f, params.lacunarity, params.persistence);
+
+	//Gets the noise values for each row at once.
+	for (int y = y0; y < y1; y++) {
+		float mappedY = (float)(originY + y) / params.height * params.noiseScale + params.offsetY;
+		if (params.octaves > 1) {
+			noise.fractalRow(params.octaves, noiseValues.data(), mappedX.data(), mappedY, rowWidth);
+		}
+		else {
+			noise.sampleRow(noiseValues.data(), mappedX.data(), mappedY, rowWidth);
+		}
+		uint8_t* row = cells.row(y) + x0;
+		for (int x = 0; x < rowWidth; x++) {
+			row[x] = (noiseValues[x] <= noiseThreshold) ? Occupied : Free;
+		}
+	}
+}
+
+//Performs a number of passes of a given ruleset of cellular automata to smooth the cave.
+//Returns the iterations after which smoothing reached a fixed point, otherwise -1.
+int CaveGenerator::smooth(const CaveParams &params) {
+	return smoothCells(cave, params, border, params.threads);
+}
+
+//Smooths cells with the rule of the parameters, leaving cells within the given border unchanged.
+//Radius 1 threshold rules, including the default rule, use the bit-packed automata and any other
+//rule counts neighbours from a summed-area table. Throws invalid_argument for a malformed rule.
+int CaveGenerator::smoothCells(CaveGrid &cells, const CaveParams &params, int cellBorder, int threads) {
+	CellularRule rule = CellularRule::parse(params.rule, params.ruleRadius);
+	int birthThreshold, deathThreshold;
+	if (rule.radius == 1 && cellBorder >= 1 && rule.thresholds(birthThreshold, deathThreshold)) {
+		if (params.incremental) {
+			return CellularAutomata::smoothIncremental(cells, params.smoothIterations, cellBorder, birthThreshold, deathThreshold, threads);
+		}
+		CellularAutomata::smooth(cells, params.smoothIterations, cellBorder, birthThreshold, deathThreshold, threads);
+		return -1;
+	}
+	return CellularAutomata::smoothSummed(cells, params.smoothIterations, cellBorder, rule, threads);
+}
+
+//Labels the free and occupied regions of the cave and picks the first cell of the largest free region as the start.
+void CaveGenerator::findStartCell(const CaveParams &params) {
+
+	components.label(cave, params.threads);
+	startCell = Cell(0,0);
+	startCount = 0;
+	freeComponentCount = 0;
+	largestComponentSize = 0;
+	int maxOrder = 0;
+
+	//Iterates over the free components. Ties go to the component reached first scanning column by column.
+	for (int c = 0; c < components.getComponentCount(); c++) {
+		if (components.getState(c) != Free) { continue; }
+		freeComponentCount++;
+		largestComponentSize = max(largestComponentSize, components.getSize(c));
+		int count = components.getSize(c) - 1;
+		Cell first = components.getFirstCell(c);
+		int order = first.x * cave.getHeight() + first.y;
+		if (count > startCount || (count == startCount && count > 0 && order < maxOrder)) {
+			startCount = count;
+			maxOrder = order;
+			startCell = first;
+		}
+	}
+}
+
+//Changes all inaccessible free cells to occupied cells, returning the number of free regions removed.
+//Reuses the components labelled by findStartCell.
+int CaveGenerator::fillInaccessibleAreas() {
+
+	//No free start cell means there is no accessible area.
+	if (cave(startCell.x,startCell.y) != Free) {
+		cave.fill(Occupied);
+		return freeComponentCount;
+	}
+
+	//Keeps only the cells in the same component as the start cell free.
+	const int startLabel = components.getLabel(startCell.x, startCell.y);
+	const vector<int> &labels = components.getLabels();
+	uint8_t* cells = cave.data();
+	for (size_t i = 0; i < cave.size(); i++) {
+		cells[i] = (labels[i] == startLabel) ? Free : Occupied;
+	}
+	return freeComponentCount - 1;
+}
+
+//Removes occupied areas not connected to the cave border, returning the number of areas removed.
+int CaveGenerator::removeNonBorderOccupiedAreas(const CaveParams &params) {
+
+	//Relabels the cave as filling inaccessible areas joins occupied regions together.
+	components.label(cave, params.threads);
+
+	//Every occupied component other than the one containing the border becomes free.
+	const int borderLabel = components.getLabel(0,0);
+	const vector<int> &labels = components.getLabels();
+	uint8_t* cells = cave.data();
+	for (size_t i = 0; i < cave.size(); i++) {
+		if (cells[i] == Occupied && labels[i] != borderLabel) {
+			cells[i] = Free;
+		}
+	}
+
+	int removed = 0;
+	for (int c = 0; c < components.getComponentCount(); c++) {
+		removed += (components.getState(c) == Occupied && c != borderLabel);
+	}
+	return removed;
+}
+
+const CaveGrid& CaveGenerator::getCave() const {
+	return cave;
+}
+
+Cell CaveGenerator::getStartCell() const {
+	return startCell;
+}
+
+int CaveGenerator::getStartCount() const {
+	return startCount;
+}
+
+int CaveGenerator::getFreeComponentCount() const {
+	return freeComponentCount;
+}
+
+int CaveGenerator::getLargestComponentSize() const {
+	return largestComponentSize;
+}
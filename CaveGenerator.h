@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include "CaveGrid.h"
+#include "Cell.h"
+#include "ConnectedComponents.h"
+using namespace std;
+
+//Parameters that fully determine a generated cave.
+struct CaveParams {
+  int width; //Number of cells making the width of the cave.
+  int height; //Number of cells making the height of the cave.
+  float offsetX; //Noise offset along the x-axis.
+  float offsetY; //Noise offset along the y-axis.
+  float fillPercentage; //Percentage of the initial cave that is occupied.
+  float noiseScale; //Size of the noise features.
+  int smoothIterations; //Cellular automata passes.
+  string rule; //Cellular automata B/S rule over free neighbours, see CellularRule.
+  int ruleRadius; //Radius of the square neighbourhood counted by the rule.
+  uint64_t seed; //Noise seed, 0 uses the classic noise table.
+  int octaves; //Octaves of fractal (fBm) noise, 1 uses plain simplex noise.
+  float lacunarity; //Frequency multiplier between successive octaves.
+  float persistence; //Amplitude multiplier between successive octaves.
+  int threads; //Threads used by the generation stages, 0 uses the whole shared pool.
+  bool incremental; //Smooths only cells whose neighbours changed, stopping at a fixed point. Gives the same cave.
+  CaveParams() : width(250), height(180), offsetX(0), offsetY(0), fillPercentage(50), noiseScale(50),
+    smoothIterations(10), rule("B5678/S45678"), ruleRadius(1), seed(0), octaves(1), lacunarity(2.0f), persistence(0.5f), threads(0), incremental(true) {}
+};
+
+//Measurements of one generation run, filled in by CaveGenerator::generate when requested.
+struct CaveMetrics {
+  double randomiseTime; //Seconds spent in each stage.
+  double smoothTime;
+  double startTime;
+  double fillTime;
+  double removeTime;
+  int freeComponents; //Free regions after smoothing.
+  int largestComponent; //Cells in the largest free region after smoothing.
+  int removedFreePockets; //Free regions filled in as inaccessible.
+  int removedOccupiedPockets; //Occupied regions not connected to the border that were freed.
+  int freeCells; //Free cells in the finished cave.
+  int convergedIteration; //Iterations after which smoothing reached a fixed point, -1 if it did not or was not incremental.
+  CaveMetrics() : randomiseTime(0), smoothTime(0), startTime(0), fillTime(0), removeTime(0), freeComponents(0),
+    largestComponent(0), removedFreePockets(0), removedOccupiedPockets(0), freeCells(0), convergedIteration(-1) {}
+};
+
+//Progress of a generation run that another thread may watch. Setting cancelled stops the run
+//at the end of its current stage.
+struct CaveProgress {
+  atomic<int> stage; //Stages completed, out of CaveGenerator::stageCount.
+  atomic<bool> cancelled;
+  CaveProgress() : stage(0), cancelled(false) {}
+};
+
+//Generates caves with no inaccessible areas, no non-border connected occupied cells and smoothed.
+//Has no dependency on OpenGL, so it is shared by the visualiser and the command line tools.
+//Each generator owns its cave and labelling buffers, so separate generators may run concurrently.
+class CaveGenerator {
+public:
+  static const int border = 3; //Padding of the cave border.
+  static const int stageCount = 5; //Stages run by generate.
+  CaveGenerator();
+  bool generate(const CaveParams &params, CaveMetrics *metrics = nullptr, CaveProgress *progress = nullptr);
+  void randomise(const CaveParams &params);
+  int smooth(const CaveParams &params);
+  void findStartCell(const CaveParams &params);
+  int fillInaccessibleAreas();
+  int removeNonBorderOccupiedAreas(const CaveParams &params);
+  static int smoothCells(CaveGrid &cells, const CaveParams &params, int cellBorder, int threads);
+  static void fillNoise(CaveGrid &cells, int originX, int originY, int x0, int x1, int y0, int y1, const CaveParams &params);
+  static const char* stageName(int stage);
+  const CaveGrid& getCave() const;
+  Cell getStartCell() const;
+  int getStartCount() const;
+  int getFreeComponentCount() const;
+  int getLargestComponentSize() const;
+private:
+  CaveGrid cave;
+  ConnectedComponents components; //Free and occupied regions of the cave.
+  Cell startCell;
+  int startCount; //Number of cells connected to the start cell.
+  int freeComponentCount; //Free regions found by findStartCell.
+  int largestComponentSize; //Cells in the largest free region found by findStartCell.
+};
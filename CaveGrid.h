@@ -0,0 +1,48 @@
+#ifndef CAVEGRID_H
+#define CAVEGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+//Contiguous row-major grid of cave cells whose dimensions are set at runtime.
+//Cells hold MapCell values and are indexed as (x,y) to match the rest of the simulation.
+class CaveGrid {
+public:
+  CaveGrid() : width(0), height(0) {}
+  CaveGrid(int _width, int _height, uint8_t value) : width(_width), height(_height), cells((size_t)_width * _height, value) {}
+
+  //Resizes the grid, setting every cell to the given value.
+  void resize(int _width, int _height, uint8_t value) {
+    width = _width;
+    height = _height;
+    cells.assign((size_t)width * height, value);
+  }
+
+  //Sets every cell in the grid to the given value.
+  void fill(uint8_t value) {
+    cells.assign(cells.size(), value);
+  }
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  size_t size() const { return cells.size(); }
+  uint8_t* data() { return cells.data(); }
+  const uint8_t* data() const { return cells.data(); }
+  uint8_t* row(int y) { return cells.data() + (size_t)y * width; }
+  const uint8_t* row(int y) const { return cells.data() + (size_t)y * width; }
+
+  //Maps a cell to its position in the underlying buffer.
+  size_t index(int x, int y) const { return (size_t)y * width + x; }
+
+  uint8_t& operator()(int x, int y) { return cells[(size_t)y * width + x]; }
+  uint8_t operator()(int x, int y) const { return cells[(size_t)y * width + x]; }
+
+private:
+  int width;
+  int height;
+  vector<uint8_t> cells;
+};
+
+#endif
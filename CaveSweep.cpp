@@ -0,0 +1,105 @@
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include "CaveSweep.h"
+#include "ThreadPool.h"
+using namespace std;
+
+//Every value of the range. The end is nudged so accumulated float error cannot drop the last value.
+vector<float> SweepRange::values() const {
+	vector<float> result;
+	if (step <= 0) {
+		result.push_back(min);
+		return result;
+	}
+	int count = (int)((max - min) / step + 1e-4f) + 1;
+	for (int i = 0; i < count; i++) {
+		result.push_back(min + i * step);
+	}
+	return result;
+}
+
+//Parses "value", "min:max" (a step of 1) or "min:max:step".
+SweepRange SweepRange::parse(const string &s) {
+	vector<float> parts;
+	stringstream stream(s);
+	string part;
+	while (getline(stream, part, ':')) {
+		parts.push_back(stof(part));
+	}
+	if (parts.empty() || parts.size() > 3) { throw invalid_argument(s); }
+	SweepRange range(parts[0]);
+	if (parts.size() > 1) { range.max = parts[1]; }
+	if (parts.size() > 2) { range.step = parts[2]; }
+	if (range.max < range.min) { swap(range.min, range.max); }
+	return range;
+}
+
+CaveSweep::CaveSweep(const CaveParams &base, const SweepRange &fill, const SweepRange &scale, const SweepRange &iterations, uint64_t firstSeed, int seeds) :
+	base(base), fills(fill.values()), scales(scale.values()), iterations(iterations.values()), firstSeed(firstSeed), seeds(seeds) {}
+
+//Number of caves in the sweep.
+size_t CaveSweep::size() const {
+	return fills.size() * scales.size() * iterations.size() * seeds;
+}
+
+//Parameters of a cave in the sweep. Seeds vary fastest, then iterations, scales and fills.
+CaveParams CaveSweep::getParams(size_t index) const {
+	CaveParams params = base;
+	params.threads = 1;
+	params.seed = firstSeed + index % seeds;
+	index /= seeds;
+	params.smoothIterations = (int)iterations[index % iterations.size()];
+	index /= iterations.size();
+	params.noiseScale = scales[index % scales.size()];
+	index /= scales.size();
+	params.fillPercentage = fills[index];
+	return params;
+}
+
+//Generates every cave of the sweep, one per thread of the shared pool.
+//Rows are written in sweep order as soon as every earlier cave has finished.
+void CaveSweep::run(ostream &csv) {
+	writeHeader(csv);
+	mutex csvMutex;
+	map<size_t, string> pending; //Finished rows waiting for an earlier cave.
+	size_t nextRow = 0;
+
+	ThreadPool::shared().run(size(), [&](size_t index) {
+		CaveParams params = getParams(index);
+		CaveGenerator caveGenerator;
+		CaveMetrics metrics;
+		caveGenerator.generate(params, &metrics);
+		ostringstream row;
+		writeRow(row, index, params, metrics, caveGenerator.getCave(), caveGenerator.getStartCell());
+
+		lock_guard<mutex> lock(csvMutex);
+		pending[index] = row.str();
+		while (!pending.empty() && pending.begin()->first == nextRow) {
+			csv << pending.begin()->second;
+			pending.erase(pending.begin());
+			nextRow++;
+		}
+		csv.flush();
+	});
+}
+
+void CaveSweep::writeHeader(ostream &csv) {
+	csv << "index,seed,width,height,offset_x,offset_y,fill,scale,iterations,rule,radius,octaves,lacunarity,persistence,"
+		<< "free_ratio,free_components,largest_component,removed_free_pockets,removed_occupied_pockets,start_x,start_y,"
+		<< "converged_iteration,randomise_ms,smooth_ms,start_ms,fill_ms,remove_ms,total_ms" << endl;
+}
+
+void CaveSweep::writeRow(ostream &csv, size_t index, const CaveParams &params, const CaveMetrics &metrics, const CaveGrid &cave, Cell startCell) {
+	const double ms = 1000.0;
+	double total = metrics.randomiseTime + metrics.smoothTime + metrics.startTime + metrics.fillTime + metrics.removeTime;
+	double freeRatio = cave.size() ? (double)metrics.freeCells / cave.size() : 0.0;
+	csv << index << "," << params.seed << "," << params.width << "," << params.height << ","
+		<< params.offsetX << "," << params.offsetY << "," << params.fillPercentage << "," << params.noiseScale << ","
+		<< params.smoothIterations << ",\"" << params.rule << "\"," << params.ruleRadius << "," << params.octaves << "," << params.lacunarity << "," << params.persistence << ","
+		<< freeRatio << "," << metrics.freeComponents << "," << metrics.largestComponent << ","
+		<< metrics.removedFreePockets << "," << metrics.removedOccupiedPockets << "," << startCell.x << "," << startCell.y << ","
+		<< metrics.convergedIteration << "," << metrics.randomiseTime * ms << "," << metrics.smoothTime * ms << "," << metrics.startTime * ms << ","
+		<< metrics.fillTime * ms << "," << metrics.removeTime * ms << "," << total * ms << "\n";
+}
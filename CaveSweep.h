@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include "CaveGenerator.h"
+using namespace std;
+
+//Values min, min + step, ... up to max of a swept parameter.
+struct SweepRange {
+  float min;
+  float max;
+  float step;
+  SweepRange(float value) : min(value), max(value), step(1) {}
+  vector<float> values() const;
+  static SweepRange parse(const string &s);
+};
+
+//Generates every cave in a grid of fill percentages, noise scales, smoothing iterations and seeds
+//on the shared thread pool, streaming the quality metrics of each cave to a CSV as they finish.
+//Each cave runs the same CaveGenerator pipeline as the visualiser.
+class CaveSweep {
+public:
+  CaveSweep(const CaveParams &base, const SweepRange &fill, const SweepRange &scale, const SweepRange &iterations, uint64_t firstSeed, int seeds);
+  size_t size() const;
+  CaveParams getParams(size_t index) const;
+  void run(ostream &csv);
+  static void writeHeader(ostream &csv);
+  static void writeRow(ostream &csv, size_t index, const CaveParams &params, const CaveMetrics &metrics, const CaveGrid &cave, Cell startCell);
+private:
+  CaveParams base;
+  vector<float> fills;
+  vector<float> scales;
+  vector<float> iterations;
+  uint64_t firstSeed;
+  int seeds; //Seeds generated for each parameter combination.
+};
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+#include "CaveWorker.h"
+#include "CaveFile.h"
+using namespace std;
+
+//Starts the worker thread, which sleeps until the first request.
+CaveWorker::CaveWorker(const string &cacheDirectory) : cacheDirectory(cacheDirectory), stopping(false), hasRequest(false),
+	requestCache(false), requestRadius(-1), requestMethod(Raycast), runRadius(-1), running(false), hasResult(false) {
+	worker = thread(&CaveWorker::workerLoop, this);
+}
+
+//Cancels the run in progress and waits for the worker thread to finish its current stage.
+CaveWorker::~CaveWorker() {
+	{
+		lock_guard<mutex> lock(stateMutex);
+		stopping = true;
+		progress.cancelled = true;
+	}
+	stateChanged.notify_all();
+	worker.join();
+}
+
+//Queues a cave for generation, cancelling any earlier request and discarding any result not yet taken.
+//A non-negative search radius also builds the visibility of the cave with the given sensing method.
+void CaveWorker::request(const CaveParams &params, bool useCache, float senseRadius, SenseMethod senseMethod) {
+	{
+		lock_guard<mutex> lock(stateMutex);
+		requestParams = params;
+		requestCache = useCache;
+		requestRadius = senseRadius;
+		requestMethod = senseMethod;
+		hasRequest = true;
+		hasResult = false;
+		progress.cancelled = true;
+	}
+	stateChanged.notify_all();
+}
+
+//Moves the finished cave into result if there is one. Never blocks on generation.
+bool CaveWorker::takeResult(CaveResult &out) {
+	lock_guard<mutex> lock(stateMutex);
+	if (!hasResult) { return false; }
+	swap(out, result);
+	hasResult = false;
+	return true;
+}
+
+//Waits for the latest request to finish, then moves its cave into result.
+void CaveWorker::waitForResult(CaveResult &out) {
+	unique_lock<mutex> lock(stateMutex);
+	stateChanged.wait(lock, [this] { return hasResult; });
+	swap(out, result);
+	hasResult = false;
+}
+
+//Whether a request is waiting or being generated.
+bool CaveWorker::isBusy() const {
+	lock_guard<mutex> lock(stateMutex);
+	return hasRequest || running;
+}
+
+//Stages completed by the current run, out of getStageCount.
+int CaveWorker::getStage() const {
+	return progress.stage;
+}
+
+//Generation stages, plus the visibility when the current run builds it.
+int CaveWorker::getStageCount() const {
+	lock_guard<mutex> lock(stateMutex);
+	return CaveGenerator::stageCount + (runRadius >= 0);
+}
+
+//Name of the stage the current run is in.
+const char* CaveWorker::getStageName() const {
+	int stage = progress.stage;
+	return (stage < CaveGenerator::stageCount) ? CaveGenerator::stageName(stage) : "Visibility";
+}
+
+//Takes the latest request, generates it without holding the lock and publishes the cave
+//unless a newer request arrived in the meantime.
+void CaveWorker::workerLoop() {
+	unique_lock<mutex> lock(stateMutex);
+	while (true) {
+		stateChanged.wait(lock, [this] { return stopping || hasRequest; });
+		if (stopping) { return; }
+		CaveParams params = requestParams;
+		bool useCache = requestCache;
+		float senseRadius = requestRadius;
+		SenseMethod senseMethod = requestMethod;
+		runRadius = senseRadius;
+		hasRequest = false;
+		running = true;
+		progress.stage = 0;
+		progress.cancelled = false;
+		lock.unlock();
+
+		CaveResult finished;
+		bool complete = run(params, useCache, senseRadius, senseMethod, finished);
+
+		lock.lock();
+		running = false;
+		if (complete && !hasRequest && !stopping) {
+			swap(result, finished);
+			hasResult = true;
+			stateChanged.notify_all();
+		}
+	}
+}
+
+//Loads the cave from the cache if it has been generated before, otherwise generates and caches it.
+//The visibility, when requested, is likewise loaded from next to the cached cave or built and saved there.
+//Returns false if the run was cancelled.
+bool CaveWorker::run(const CaveParams &params, bool useCache, float senseRadius, SenseMethod senseMethod, CaveResult &out) {
+	out.params = params;
+	CaveFile cachedCave;
+	if (useCache) {
+		out.cachePath = CaveFile::cachePath(cacheDirectory, params);
+		if (cachedCave.open(out.cachePath) && cachedCave.matches(params)) {
+			cachedCave.unpack(out.cave);
+			out.startCell = cachedCave.getStartCell();
+			out.startCount = cachedCave.getHeader().startCount;
+			out.loaded = true;
+		}
+	}
+	if (!out.loaded) {
+		if (!generator.generate(params, nullptr, &progress)) { return false; }
+		out.cave = generator.getCave();
+		out.startCell = generator.getStartCell();
+		out.startCount = generator.getStartCount();
+		if (useCache) {
+			mkdir(cacheDirectory.c_str(), 0755);
+			out.cacheFailed = !CaveFile::save(out.cachePath, params, out.cave, out.startCell, out.startCount);
+		}
+	}
+	progress.stage = CaveGenerator::stageCount;
+	if (senseRadius < 0) { return true; }
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	string visibilityPath = useCache ? VisibilityCache::cachePath(out.cachePath, senseRadius, senseMethod) : "";
+	out.visibilityLoaded = useCache && out.visibility.load(visibilityPath, out.cave) && out.visibility.covers(out.cave, senseRadius, senseMethod);
+	if (!out.visibilityLoaded) {
+		if (!out.visibility.build(out.cave, senseRadius, senseMethod, params.threads, &progress.cancelled)) { return !progress.cancelled; }
+		if (useCache) { out.visibility.save(visibilityPath); }
+	}
+	out.visibilityTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return true;
+}
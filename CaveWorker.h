@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "CaveGrid.h"
+#include "CaveGenerator.h"
+#include "VisibilityCache.h"
+#include "SenseMethod.h"
+#include "Cell.h"
+using namespace std;
+
+//Finished cave handed over by a CaveWorker.
+struct CaveResult {
+  CaveParams params;
+  CaveGrid cave;
+  Cell startCell;
+  int startCount; //Number of cells connected to the start cell.
+  bool loaded; //Read from the cache rather than generated.
+  bool cacheFailed; //Generated but could not be written to the cache.
+  string cachePath; //Cache file of the cave, empty when caching is off.
+  VisibilityCache visibility; //Cells sensed from each free cell, empty unless requested.
+  bool visibilityLoaded; //Visibility read from the cache rather than built.
+  double visibilityTime; //Seconds spent building or loading the visibility.
+  CaveResult() : startCount(0), loaded(false), cacheFailed(false), visibilityLoaded(false), visibilityTime(0) {}
+};
+
+//Generates caves on a background thread, so callers such as the render loop never wait for them.
+//Only the latest request matters: a new request cancels the run in progress at the end of its current
+//stage and replaces any request still waiting and any result not yet taken. Results are handed over
+//whole by takeResult, so a partially generated cave is never seen.
+//A request may also ask for the visibility of the cave, built after the cave as one more stage.
+class CaveWorker {
+public:
+  explicit CaveWorker(const string &cacheDirectory);
+  ~CaveWorker();
+  void request(const CaveParams &params, bool useCache, float senseRadius = -1, SenseMethod senseMethod = Raycast);
+  bool takeResult(CaveResult &result);
+  void waitForResult(CaveResult &result);
+  bool isBusy() const;
+  int getStage() const;
+  int getStageCount() const;
+  const char* getStageName() const;
+private:
+  string cacheDirectory;
+  CaveGenerator generator; //Only used by the worker thread.
+  CaveProgress progress; //Progress of the current run.
+  mutable mutex stateMutex; //Guards every member below.
+  condition_variable stateChanged;
+  bool stopping;
+  bool hasRequest; //A request is waiting for the worker thread.
+  CaveParams requestParams;
+  bool requestCache;
+  float requestRadius; //Search radius of the visibility, negative for none.
+  SenseMethod requestMethod;
+  float runRadius; //Search radius of the visibility of the run in progress.
+  bool running; //The worker thread is generating a cave.
+  bool hasResult; //A finished cave is waiting to be taken.
+  CaveResult result;
+  thread worker;
+  void workerLoop();
+  bool run(const CaveParams &params, bool useCache, float senseRadius, SenseMethod senseMethod, CaveResult &out);
+};
@@ -0,0 +1,562 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "CellularAutomata.h"
+#include "MapCell.h"
+#include "ThreadPool.h"
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CA_X86_SIMD
+typedef uint64_t u64x2 __attribute__((vector_size(16))); //SSE2 register of two words.
+typedef uint64_t u64x4 __attribute__((vector_size(32))); //AVX2 register of four words.
+#endif
+
+//Loads/stores a word or SIMD register of words from an unaligned position.
+//Words are passed by reference so SIMD registers never cross a function boundary.
+template <typename T>
+static inline __attribute__((always_inline)) void loadWords(T &v, const uint64_t* p) {
+	memcpy(&v, p, sizeof(T));
+}
+
+template <typename T>
+static inline __attribute__((always_inline)) void storeWords(uint64_t* p, const T &v) {
+	memcpy(p, &v, sizeof(T));
+}
+
+//Bit-sliced comparison of a 4-bit count against a constant threshold.
+template <typename T>
+static inline __attribute__((always_inline)) void compareCount(const T count[4], int threshold, T &greater, T &equal) {
+	greater = count[0] ^ count[0];
+	equal = ~greater;
+	//Negative thresholds are exceeded by every count.
+	if (threshold < 0) {
+		greater = ~greater;
+		equal = ~equal;
+		return;
+	}
+	if (threshold > 15) {
+		equal = ~equal;
+		return;
+	}
+	for (int b = 3; b >= 0; b--) {
+		if ((threshold >> b) & 1) {
+			equal &= count[b];
+		}
+		else {
+			greater |= equal & count[b];
+			equal &= ~count[b];
+		}
+	}
+}
+
+//Applies one iteration of the birth/death rule to words [k0, k1) of a row.
+//Lanes words are processed per step, T being either a single word or a SIMD register.
+template <typename T, int Lanes>
+static inline __attribute__((always_inline)) int smoothSpan(const uint64_t* above, const uint64_t* current, const uint64_t* below, uint64_t* out, const uint64_t* masks, int k0, int k1, int birthThreshold, int deathThreshold) {
+	int k = k0;
+	for (; k + Lanes <= k1; k += Lanes) {
+		//Cell state and its west/east neighbours for the three rows.
+		T a, aw, ae, c, cw, ce, b, bw, be;
+		loadWords(a, above + k);
+		loadWords(aw, above + k - 1);
+		loadWords(ae, above + k + 1);
+		loadWords(c, current + k);
+		loadWords(cw, current + k - 1);
+		loadWords(ce, current + k + 1);
+		loadWords(b, below + k);
+		loadWords(bw, below + k - 1);
+		loadWords(be, below + k + 1);
+		aw = (a << 1) | (aw >> 63);
+		ae = (a >> 1) | (ae << 63);
+		cw = (c << 1) | (cw >> 63);
+		ce = (c >> 1) | (ce << 63);
+		bw = (b << 1) | (bw >> 63);
+		be = (b >> 1) | (be << 63);
+
+		//Adds the eight neighbours into a bit-sliced 4-bit count.
+		T s0 = aw ^ a ^ ae;
+		T c0 = (aw & a) | (ae & (aw ^ a));
+		T s1 = cw ^ ce ^ bw;
+		T c1 = (cw & ce) | (bw & (cw ^ ce));
+		T s2 = b ^ be;
+		T c2 = b & be;
+		T count[4];
+		count[0] = s0 ^ s1 ^ s2;
+		T k2 = (s0 & s1) | (s2 & (s0 ^ s1));
+		T t = c0 ^ c1 ^ c2;
+		T u = (c0 & c1) | (c2 & (c0 ^ c1));
+		count[1] = t ^ k2;
+		T v = t & k2;
+		count[2] = u ^ v;
+		count[3] = u & v;
+
+		//Cells born above the birth threshold, killed below the death threshold, otherwise unchanged.
+		T born, bornEq, dieGreater, dieEq;
+		compareCount(count, birthThreshold, born, bornEq);
+		compareCount(count, deathThreshold, dieGreater, dieEq);
+		T survive = dieGreater | dieEq;
+		T next = born | (survive & c);
+
+		//Cells outside the interior mask keep their state.
+		T m;
+		loadWords(m, masks + k);
+		next = (next & m) | (c & ~m);
+		storeWords(out + k, next);
+	}
+	return k;
+}
+
+template <typename T, int Lanes>
+static inline __attribute__((always_inline)) void smoothRows(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold) {
+	const int words = src.getWordsPerRow();
+	for (int y = rowBegin; y < rowEnd; y++) {
+		const uint64_t* above = src.row(y + 1);
+		const uint64_t* current = src.row(y);
+		const uint64_t* below = src.row(y - 1);
+		uint64_t* out = dst.row(y);
+		int k = smoothSpan<T, Lanes>(above, current, below, out, masks.data(), 0, words, birthThreshold, deathThreshold);
+		smoothSpan<uint64_t, 1>(above, current, below, out, masks.data(), k, words, birthThreshold, deathThreshold);
+	}
+}
+
+//Applies one iteration of the rule to the active words of rows [rowBegin, rowEnd).
+//A word is active when a cell in or next to it changed in the previous iteration, read from the
+//changed word bitmaps of that iteration: changed marks words with any changed cell, west and east
+//words whose first (lowest) or last (highest) cell changed, which also touch the word either side.
+//The words that change now are recorded in the next bitmaps, returning whether any word changed.
+template <typename T, int Lanes>
+static inline __attribute__((always_inline)) bool smoothActiveRows(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold, const BitGrid previous[3], BitGrid next[3], bool everyWord) {
+	const int words = src.getWordsPerRow();
+	const int mapWords = previous[0].getWordsPerRow();
+	bool anyChanged = false;
+	for (int y = rowBegin; y < rowEnd; y++) {
+		const uint64_t* above = src.row(y + 1);
+		const uint64_t* current = src.row(y);
+		const uint64_t* below = src.row(y - 1);
+		uint64_t* out = dst.row(y);
+		uint64_t* changed = next[0].row(y);
+		uint64_t* west = next[1].row(y);
+		uint64_t* east = next[2].row(y);
+		fill(changed, changed + mapWords, 0);
+		fill(west, west + mapWords, 0);
+		fill(east, east + mapWords, 0);
+
+		for (int m = 0; m < mapWords; m++) {
+			//Active words of this bitmap word, gathered from the changes in the rows either side.
+			uint64_t active = everyWord ? ~(uint64_t)0 : 0;
+			for (int dy = -1; dy <= 1 && !everyWord; dy++) {
+				const uint64_t* c = previous[0].row(y + dy);
+				const uint64_t* w = previous[1].row(y + dy);
+				const uint64_t* e = previous[2].row(y + dy);
+				active |= c[m] | (w[m] >> 1) | (w[m + 1] << 63) | (e[m] << 1) | (e[m - 1] >> 63);
+			}
+			active &= BitGrid::columnMask(m, 0, words);
+
+			//Smooths each run of consecutive active words, then records the words that changed.
+			while (active) {
+				int k0 = __builtin_ctzll(active);
+				uint64_t run = active + ((uint64_t)1 << k0);
+				int k1 = run ? __builtin_ctzll(run) : 64;
+				active &= (k1 < 64) ? ~((((uint64_t)1 << k1) - 1)) : 0;
+				k0 += m * 64;
+				k1 += m * 64;
+				int k = smoothSpan<T, Lanes>(above, current, below, out, masks.data(), k0, k1, birthThreshold, deathThreshold);
+				smoothSpan<uint64_t, 1>(above, current, below, out, masks.data(), k, k1, birthThreshold, deathThreshold);
+				for (k = k0; k < k1; k++) {
+					uint64_t difference = out[k] ^ current[k];
+					if (difference) {
+						uint64_t bit = (uint64_t)1 << (k & 63);
+						changed[k >> 6] |= bit;
+						if (difference & 1) { west[k >> 6] |= bit; }
+						if (difference >> 63) { east[k >> 6] |= bit; }
+						anyChanged = true;
+					}
+				}
+			}
+		}
+	}
+	return anyChanged;
+}
+
+#ifdef CA_X86_SIMD
+__attribute__((target("avx2")))
+static void smoothRowsAVX2(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold) {
+	smoothRows<u64x4, 4>(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold);
+}
+
+static void smoothRowsSSE2(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold) {
+	smoothRows<u64x2, 2>(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold);
+}
+
+__attribute__((target("avx2")))
+static bool smoothActiveRowsAVX2(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold, const BitGrid previous[3], BitGrid next[3], bool everyWord) {
+	return smoothActiveRows<u64x4, 4>(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold, previous, next, everyWord);
+}
+
+static bool smoothActiveRowsSSE2(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold, const BitGrid previous[3], BitGrid next[3], bool everyWord) {
+	return smoothActiveRows<u64x2, 2>(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold, previous, next, everyWord);
+}
+#endif
+
+//Bit masks of the columns within the cave border for each word of a row.
+vector<uint64_t> CellularAutomata::interiorMasks(int width, int border) {
+	vector<uint64_t> masks((width + 63) / 64);
+	for (size_t k = 0; k < masks.size(); k++) {
+		masks[k] = BitGrid::columnMask(k, border, width - border);
+	}
+	return masks;
+}
+
+//Performs one iteration of the rule for rows [rowBegin, rowEnd) of the source into the destination.
+//Rows must lie at least one row inside the grid so their neighbours exist.
+void CellularAutomata::step(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold) {
+#ifdef CA_X86_SIMD
+	static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+	if (hasAVX2) {
+		smoothRowsAVX2(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold);
+	}
+	else {
+		smoothRowsSSE2(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold);
+	}
+#else
+	smoothRows<uint64_t, 1>(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold);
+#endif
+}
+
+//Performs one iteration of the rule for the active words of rows [rowBegin, rowEnd), see smoothActiveRows.
+bool CellularAutomata::stepActive(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold, const BitGrid previous[3], BitGrid next[3], bool everyWord) {
+#ifdef CA_X86_SIMD
+	static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+	if (hasAVX2) {
+		return smoothActiveRowsAVX2(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold, previous, next, everyWord);
+	}
+	return smoothActiveRowsSSE2(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold, previous, next, everyWord);
+#else
+	return smoothActiveRows<uint64_t, 1>(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold, previous, next, everyWord);
+#endif
+}
+
+//Smooths the cave by counting free Moore neighbours of every cell inside the border.
+//A cell becomes free above the birth threshold, occupied below the death threshold and otherwise keeps its state.
+//Up to the given number of threads smooth separate bands of rows (0 uses the whole shared pool).
+void CellularAutomata::smooth(CaveGrid &cave, int iterations, int border, int birthThreshold, int deathThreshold, int threads) {
+	if (iterations <= 0) { return; }
+
+	//Both buffers start as the packed cave so the border stays intact when they are swapped.
+	BitGrid buffers[2];
+	buffers[0].pack(cave, Free);
+	buffers[1] = buffers[0];
+	vector<uint64_t> masks = interiorMasks(cave.getWidth(), border);
+
+	//Rows without a neighbour on both sides are never smoothed.
+	int rowBegin = max(border, 1);
+	int rowEnd = min(cave.getHeight() - border, cave.getHeight() - 1);
+	int rows = rowEnd - rowBegin;
+	if (rows <= 0) { return; }
+
+	//Bands are kept to a minimum height so small caves are not split needlessly.
+	const int minBandRows = 64;
+	ThreadPool &pool = ThreadPool::shared();
+	int bands = (threads <= 0) ? pool.size() : min(threads, pool.size());
+	bands = max(1, min(bands, rows / minBandRows));
+
+	int current = 0;
+	for (int i = 0; i < iterations; i++) {
+		const BitGrid &src = buffers[current];
+		BitGrid &dst = buffers[1 - current];
+		if (bands == 1) {
+			step(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold);
+		}
+		else {
+			//Each band reads the row either side of it (its halo) from the shared source buffer
+			//and writes only its own rows, so bands never conflict. run() returning is the
+			//barrier between iterations.
+			pool.run(bands, [&](size_t band) {
+				int y0 = rowBegin + (int)((long long)rows * band / bands);
+				int y1 = rowBegin + (int)((long long)rows * (band + 1) / bands);
+				step(src, dst, masks, y0, y1, birthThreshold, deathThreshold);
+			});
+		}
+		current = 1 - current;
+	}
+
+	buffers[current].unpack(cave, Free, Occupied);
+}
+
+//Smooths the cave exactly like smooth, but only revisits the words of cells whose neighbourhood
+//changed in the previous iteration and stops once an iteration changes nothing, as every later
+//iteration would then leave the cave unchanged too. Cells settle after a few iterations, so
+//high iteration counts cost little more than the iterations that actually change the cave.
+//Returns the number of iterations after which the cave reached a fixed point, or -1 if it was
+//still changing after the last iteration.
+int CellularAutomata::smoothIncremental(CaveGrid &cave, int iterations, int border, int birthThreshold, int deathThreshold, int threads) {
+	if (iterations <= 0) { return -1; }
+
+	BitGrid buffers[2];
+	buffers[0].pack(cave, Free);
+	buffers[1] = buffers[0];
+	vector<uint64_t> masks = interiorMasks(cave.getWidth(), border);
+
+	int rowBegin = max(border, 1);
+	int rowEnd = min(cave.getHeight() - border, cave.getHeight() - 1);
+	int rows = rowEnd - rowBegin;
+	if (rows <= 0) { return 0; }
+
+	//Changed word bitmaps (changed, west, east) of the previous and current iteration, one bit per word.
+	//Rows outside the smoothed rows never change, so their bitmaps stay clear.
+	BitGrid changes[2][3];
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 3; j++) {
+			changes[i][j].resize(buffers[0].getWordsPerRow(), cave.getHeight());
+		}
+	}
+
+	const int minBandRows = 64;
+	ThreadPool &pool = ThreadPool::shared();
+	int bands = (threads <= 0) ? pool.size() : min(threads, pool.size());
+	bands = max(1, min(bands, rows / minBandRows));
+
+	//Words are only stale in the destination buffer where they changed in the previous iteration,
+	//and those words are active, so every inactive word already holds its next state.
+	int current = 0;
+	int converged = -1;
+	vector<char> bandChanged(bands);
+	for (int i = 0; i < iterations; i++) {
+		const BitGrid &src = buffers[current];
+		BitGrid &dst = buffers[1 - current];
+		const BitGrid* previous = changes[current];
+		BitGrid* next = changes[1 - current];
+		bool everyWord = (i == 0);
+		if (bands == 1) {
+			bandChanged[0] = stepActive(src, dst, masks, rowBegin, rowEnd, birthThreshold, deathThreshold, previous, next, everyWord);
+		}
+		else {
+			pool.run(bands, [&](size_t band) {
+				int y0 = rowBegin + (int)((long long)rows * band / bands);
+				int y1 = rowBegin + (int)((long long)rows * (band + 1) / bands);
+				bandChanged[band] = stepActive(src, dst, masks, y0, y1, birthThreshold, deathThreshold, previous, next, everyWord);
+			});
+		}
+		current = 1 - current;
+		if (find(bandChanged.begin(), bandChanged.end(), 1) == bandChanged.end()) {
+			converged = i;
+			break;
+		}
+	}
+
+	buffers[current].unpack(cave, Free, Occupied);
+	return converged;
+}
+
+const int CellularRule::maxRadius;
+
+CellularRule::CellularRule(int radius) : radius(radius), birth(neighbours() + 1, 0), survive(neighbours() + 1, 0) {}
+
+int CellularRule::neighbours() const {
+	return (2 * radius + 1) * (2 * radius + 1) - 1;
+}
+
+//Parses a B/S rule string, throwing invalid_argument if it is malformed or lists counts beyond the neighbourhood.
+CellularRule CellularRule::parse(const string &text, int radius) {
+	if (radius < 1 || radius > maxRadius) {
+		throw invalid_argument("Rule radius must be between 1 and " + to_string(maxRadius));
+	}
+	CellularRule rule(radius);
+	size_t slash = text.find('/');
+	if (text.size() < 3 || (text[0] != 'B' && text[0] != 'b') || slash == string::npos
+		|| slash + 1 >= text.size() || (text[slash + 1] != 'S' && text[slash + 1] != 's')) {
+		throw invalid_argument("Rule must be written as B<counts>/S<counts>: " + text);
+	}
+
+	auto readNumber = [&](const string &digits) {
+		if (digits.empty() || digits.size() > 4) {
+			throw invalid_argument("Rule counts must be digits, commas and ranges: " + text);
+		}
+		return stoi(digits);
+	};
+
+	//Marks each listed count, either digit by digit or as comma separated counts and ranges.
+	auto readCounts = [&](const string &list, vector<uint8_t> &counts) {
+		if (list.find_first_not_of("0123456789,-") != string::npos) {
+			throw invalid_argument("Rule counts must be digits, commas and ranges: " + text);
+		}
+		vector<pair<int,int>> ranges;
+		if (list.find_first_of(",-") == string::npos) {
+			for (char digit : list) {
+				ranges.push_back(make_pair(digit - '0', digit - '0'));
+			}
+		}
+		else {
+			size_t begin = 0;
+			while (begin <= list.size()) {
+				size_t end = min(list.find(',', begin), list.size());
+				string item = list.substr(begin, end - begin);
+				size_t dash = item.find('-');
+				if (dash == string::npos) {
+					ranges.push_back(make_pair(readNumber(item), readNumber(item)));
+				}
+				else {
+					ranges.push_back(make_pair(readNumber(item.substr(0, dash)), readNumber(item.substr(dash + 1))));
+				}
+				begin = end + 1;
+			}
+		}
+		for (const pair<int,int> &range : ranges) {
+			if (range.first < 0 || range.second > rule.neighbours() || range.first > range.second) {
+				throw invalid_argument("Rule counts must lie between 0 and " + to_string(rule.neighbours()) + ": " + text);
+			}
+			fill(counts.begin() + range.first, counts.begin() + range.second + 1, 1);
+		}
+	};
+	readCounts(text.substr(1, slash - 1), rule.birth);
+	readCounts(text.substr(slash + 2), rule.survive);
+	return rule;
+}
+
+//Finds the birth and death thresholds of a rule where cells become free above the birth threshold
+//and stay free from the death threshold, as used by smooth. Returns false for any other rule.
+bool CellularRule::thresholds(int &birthThreshold, int &deathThreshold) const {
+	const int n = neighbours();
+	birthThreshold = n;
+	while (birthThreshold >= 0 && birth[birthThreshold]) { birthThreshold--; }
+	deathThreshold = n + 1;
+	while (deathThreshold > 0 && survive[deathThreshold - 1]) { deathThreshold--; }
+	for (int count = 0; count <= n; count++) {
+		if (birth[count] != (count > birthThreshold) || survive[count] != (count > birthThreshold || count >= deathThreshold)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Rule kernels for smoothSummed, each giving the next state of a cell from its free neighbour count.
+struct ThresholdRule {
+	int birthThreshold;
+	int deathThreshold;
+	uint8_t operator()(uint8_t cell, int count) const {
+		return (count > birthThreshold || (cell == Free && count >= deathThreshold)) ? Free : Occupied;
+	}
+};
+
+struct TableRule {
+	const uint8_t* birth;
+	const uint8_t* survive;
+	uint8_t operator()(uint8_t cell, int count) const {
+		return ((cell == Free) ? survive[count] : birth[count]) ? Free : Occupied;
+	}
+};
+
+//Summed-area table of free cells, entry (x, y) counting the free cells in [0, x) x [0, y).
+static void buildSummedTable(const CaveGrid &cave, vector<uint32_t> &table) {
+	const int width = cave.getWidth();
+	const int height = cave.getHeight();
+	const size_t stride = width + 1;
+	table.assign(stride * (height + 1), 0);
+	for (int y = 0; y < height; y++) {
+		const uint8_t* cells = cave.row(y);
+		const uint32_t* above = table.data() + (size_t)y * stride;
+		uint32_t* sums = table.data() + (size_t)(y + 1) * stride;
+		uint32_t rowSum = 0;
+		for (int x = 0; x < width; x++) {
+			rowSum += (cells[x] == Free);
+			sums[x + 1] = above[x + 1] + rowSum;
+		}
+	}
+}
+
+//Applies one iteration of a rule to rows [rowBegin, rowEnd), columns within the border. Each count
+//takes four table lookups whatever the radius, with the window clipped to the cave.
+//The rule is a template parameter so every rule kernel gets its own inner loop.
+template <typename Rule>
+static void summedRows(const CaveGrid &src, CaveGrid &dst, const vector<uint32_t> &table, int radius, int border, int rowBegin, int rowEnd, const Rule &rule) {
+	const int width = src.getWidth();
+	const int height = src.getHeight();
+	const size_t stride = width + 1;
+	for (int y = rowBegin; y < rowEnd; y++) {
+		const uint32_t* top = table.data() + (size_t)max(y - radius, 0) * stride;
+		const uint32_t* bottom = table.data() + (size_t)min(y + radius + 1, height) * stride;
+		const uint8_t* cells = src.row(y);
+		uint8_t* out = dst.row(y);
+		//Columns whose window lies within the cave need no clipping, letting that loop vectorise.
+		const int xEnd = width - border;
+		const int innerBegin = min(max(border, radius), xEnd);
+		const int innerEnd = max(min(xEnd, width - radius), innerBegin);
+		auto clipped = [&](int x) {
+			int x0 = max(x - radius, 0);
+			int x1 = min(x + radius + 1, width);
+			int count = (int)(bottom[x1] - bottom[x0] - top[x1] + top[x0]) - (cells[x] == Free);
+			out[x] = rule(cells[x], count);
+		};
+		for (int x = border; x < innerBegin; x++) { clipped(x); }
+		const uint32_t* topWest = top - radius;
+		const uint32_t* topEast = top + radius + 1;
+		const uint32_t* bottomWest = bottom - radius;
+		const uint32_t* bottomEast = bottom + radius + 1;
+		for (int x = innerBegin; x < innerEnd; x++) {
+			int count = (int)(bottomEast[x] - bottomWest[x] - topEast[x] + topWest[x]) - (cells[x] == Free);
+			out[x] = rule(cells[x], count);
+		}
+		for (int x = innerEnd; x < xEnd; x++) { clipped(x); }
+	}
+}
+
+template <typename Rule>
+static int smoothSummedRule(CaveGrid &cave, int iterations, int border, int radius, const Rule &rule, int threads) {
+	const int height = cave.getHeight();
+	int rowBegin = border;
+	int rowEnd = height - border;
+	int rows = rowEnd - rowBegin;
+	if (rows <= 0 || cave.getWidth() - 2 * border <= 0) { return 0; }
+
+	const int minBandRows = 64;
+	ThreadPool &pool = ThreadPool::shared();
+	int bands = (threads <= 0) ? pool.size() : min(threads, pool.size());
+	bands = max(1, min(bands, rows / minBandRows));
+
+	//Both buffers start as the cave so the border stays intact when they are swapped.
+	CaveGrid buffers[2] = { cave, cave };
+	vector<uint32_t> table;
+	int current = 0;
+	int converged = -1;
+	for (int i = 0; i < iterations; i++) {
+		const CaveGrid &src = buffers[current];
+		CaveGrid &dst = buffers[1 - current];
+		buildSummedTable(src, table);
+		if (bands == 1) {
+			summedRows(src, dst, table, radius, border, rowBegin, rowEnd, rule);
+		}
+		else {
+			pool.run(bands, [&](size_t band) {
+				int y0 = rowBegin + (int)((long long)rows * band / bands);
+				int y1 = rowBegin + (int)((long long)rows * (band + 1) / bands);
+				summedRows(src, dst, table, radius, border, y0, y1, rule);
+			});
+		}
+		current = 1 - current;
+		//Every later iteration leaves a fixed point unchanged.
+		if (memcmp(buffers[0].data(), buffers[1].data(), cave.size()) == 0) {
+			converged = i;
+			break;
+		}
+	}
+	swap(cave, buffers[current]);
+	return converged;
+}
+
+//Smooths the cave with any rule and neighbourhood radius, counting the free cells in each
+//neighbourhood from a summed-area table, so a radius 5 neighbourhood costs the same as radius 1.
+//Neighbourhoods reaching past the edge of the cave only count the cells within it.
+//Stops once an iteration changes nothing, returning the number of iterations after which the cave
+//reached a fixed point, or -1 if it was still changing after the last iteration.
+int CellularAutomata::smoothSummed(CaveGrid &cave, int iterations, int border, const CellularRule &rule, int threads) {
+	if (iterations <= 0) { return -1; }
+	border = max(border, 0);
+	int birthThreshold, deathThreshold;
+	if (rule.thresholds(birthThreshold, deathThreshold)) {
+		ThresholdRule kernel = { birthThreshold, deathThreshold };
+		return smoothSummedRule(cave, iterations, border, rule.radius, kernel, threads);
+	}
+	TableRule kernel = { rule.birth.data(), rule.survive.data() };
+	return smoothSummedRule(cave, iterations, border, rule.radius, kernel, threads);
+}
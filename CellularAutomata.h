@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "CaveGrid.h"
+#include "BitGrid.h"
+using namespace std;
+
+//Birth/survival rule over the free cells in the square neighbourhood of a given radius, written as a
+//B/S rule string such as B5678/S45678. Counts are single digits, or for counts above 9 are separated
+//by commas and may be ranges (e.g. B31-48/S28-48). Occupied cells become free with a birth count
+//and free cells stay free with a survival count.
+struct CellularRule {
+  static const int maxRadius = 16;
+  int radius;
+  vector<uint8_t> birth; //Indexed by free neighbour count, 1 when an occupied cell becomes free.
+  vector<uint8_t> survive; //Indexed by free neighbour count, 1 when a free cell stays free.
+  static CellularRule parse(const string &text, int radius);
+  int neighbours() const;
+  bool thresholds(int &birthThreshold, int &deathThreshold) const;
+private:
+  explicit CellularRule(int radius);
+};
+
+//Cellular automata used to smooth the cave. The cave is bit-packed (free cells set)
+//so Moore neighbour counts for 64 cells are computed at once with bit-sliced adders.
+//Large caves are split into horizontal bands smoothed concurrently on the shared thread pool.
+//smoothIncremental gives the same result while only revisiting cells whose neighbours changed.
+//smoothSummed applies any CellularRule, counting neighbours of any radius from a summed-area table.
+class CellularAutomata {
+public:
+  static void smooth(CaveGrid &cave, int iterations, int border, int birthThreshold, int deathThreshold, int threads);
+  static int smoothIncremental(CaveGrid &cave, int iterations, int border, int birthThreshold, int deathThreshold, int threads);
+  static void step(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold);
+  static int smoothSummed(CaveGrid &cave, int iterations, int border, const CellularRule &rule, int threads);
+  static bool stepActive(const BitGrid &src, BitGrid &dst, const vector<uint64_t> &masks, int rowBegin, int rowEnd, int birthThreshold, int deathThreshold, const BitGrid previous[3], BitGrid next[3], bool everyWord);
+  static vector<uint64_t> interiorMasks(int width, int border);
+};
@@ -0,0 +1,179 @@
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/stat.h>
+#include "ChunkedCave.h"
+#include "CaveFile.h"
+#include "MapCell.h"
+using namespace std;
+
+const int ChunkedCave::tileSize;
+
+//Tiles are kept in a subdirectory named by a hash of the parameters, so caves with other
+//parameters sharing the tile directory never load them.
+ChunkedCave::ChunkedCave(const CaveParams &params, const string &directory, size_t maxResidentTiles) :
+	params(params), maxResidentTiles(max((size_t)1, maxResidentTiles)) {
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx", (unsigned long long)CaveFile::paramsHash(params));
+	mkdir(directory.c_str(), 0755);
+	this->directory = directory + name;
+	mkdir(this->directory.c_str(), 0755);
+}
+
+ChunkedCave::~ChunkedCave() {
+	flush();
+}
+
+//Writes every resident tile that is not on disk yet, so later caves with the same parameters load them.
+void ChunkedCave::flush() {
+	for (auto &entry : tiles) {
+		Tile &tile = entry.second;
+		if (!tile.onDisk) {
+			tile.onDisk = saveTile((int32_t)(entry.first >> 32), (int32_t)(uint32_t)entry.first, tile.cells);
+		}
+	}
+}
+
+//Tile containing a coordinate, rounding down for negative coordinates.
+int ChunkedCave::tileOf(int x) {
+	return (x >= 0) ? x / tileSize : -((-x - 1) / tileSize) - 1;
+}
+
+uint64_t ChunkedCave::key(int tx, int ty) {
+	return ((uint64_t)(uint32_t)tx << 32) | (uint32_t)ty;
+}
+
+//State of a cell anywhere in the cave.
+uint8_t ChunkedCave::get(int x, int y) {
+	int tx = tileOf(x);
+	int ty = tileOf(y);
+	return fetch(tx, ty).cells(x - tx * tileSize, y - ty * tileSize);
+}
+
+//Copies the cells starting at (x0, y0) into a region, keeping its dimensions.
+void ChunkedCave::copyRegion(int x0, int y0, CaveGrid &region) {
+	const int width = region.getWidth();
+	const int height = region.getHeight();
+	for (int ty = tileOf(y0); ty <= tileOf(y0 + height - 1); ty++) {
+		for (int tx = tileOf(x0); tx <= tileOf(x0 + width - 1); tx++) {
+			const CaveGrid &cells = fetch(tx, ty).cells;
+			int xBegin = max(x0, tx * tileSize), xEnd = min(x0 + width, (tx + 1) * tileSize);
+			int yBegin = max(y0, ty * tileSize), yEnd = min(y0 + height, (ty + 1) * tileSize);
+			for (int y = yBegin; y < yEnd; y++) {
+				const uint8_t* src = cells.row(y - ty * tileSize) + (xBegin - tx * tileSize);
+				copy(src, src + (xEnd - xBegin), region.row(y - y0) + (xBegin - x0));
+			}
+		}
+	}
+}
+
+//Resident tile, loading or generating it if needed, and marking it most recently used.
+ChunkedCave::Tile& ChunkedCave::fetch(int tx, int ty) {
+	uint64_t k = key(tx, ty);
+	auto it = tiles.find(k);
+	if (it != tiles.end()) {
+		recentTiles.splice(recentTiles.begin(), recentTiles, it->second.recent);
+		return it->second;
+	}
+	CaveGrid cells;
+	bool onDisk = loadTile(tx, ty, cells);
+	if (!onDisk) {
+		generateTile(tx, ty, cells);
+	}
+	return insert(k, cells, onDisk);
+}
+
+//Adds a tile as the most recently used, evicting the least recently used tiles over the limit.
+ChunkedCave::Tile& ChunkedCave::insert(uint64_t k, CaveGrid &cells, bool onDisk) {
+	while (tiles.size() >= maxResidentTiles) {
+		evict();
+	}
+	recentTiles.push_front(k);
+	Tile &tile = tiles[k];
+	swap(tile.cells, cells);
+	tile.recent = recentTiles.begin();
+	tile.onDisk = onDisk;
+	return tile;
+}
+
+//Generates a tile from the noise field. The tile is smoothed with a halo as wide as the number
+//of iterations times the rule radius: each iteration leaves up to radius more rings of the halo
+//stale, so after n iterations only the halo is stale and the tile itself matches smoothing the
+//unbounded noise field.
+void ChunkedCave::generateTile(int tx, int ty, CaveGrid &cells) const {
+	const int halo = max(params.smoothIterations, 0) * params.ruleRadius;
+	const int size = tileSize + 2 * halo;
+	CaveGrid region(size, size, Occupied);
+	CaveGenerator::fillNoise(region, tx * tileSize - halo, ty * tileSize - halo, 0, size, 0, size, params);
+	CaveGenerator::smoothCells(region, params, 1, 1);
+
+	cells.resize(tileSize, tileSize, Occupied);
+	for (int y = 0; y < tileSize; y++) {
+		const uint8_t* src = region.row(y + halo) + halo;
+		copy(src, src + tileSize, cells.row(y));
+	}
+}
+
+string ChunkedCave::tilePath(int tx, int ty) const {
+	char name[64];
+	snprintf(name, sizeof(name), "/tile_%d_%d.bin", tx, ty);
+	return directory + name;
+}
+
+//Reads a tile written by saveTile, one bit per cell set when free.
+bool ChunkedCave::loadTile(int tx, int ty, CaveGrid &cells) const {
+	FILE* file = fopen(tilePath(tx, ty).c_str(), "rb");
+	if (!file) { return false; }
+	vector<uint8_t> packed(tileSize * tileSize / 8);
+	bool read = fread(packed.data(), 1, packed.size(), file) == packed.size();
+	fclose(file);
+	if (!read) { return false; }
+	cells.resize(tileSize, tileSize, Occupied);
+	uint8_t* out = cells.data();
+	for (size_t i = 0; i < cells.size(); i++) {
+		out[i] = ((packed[i >> 3] >> (i & 7)) & 1) ? Free : Occupied;
+	}
+	return true;
+}
+
+bool ChunkedCave::saveTile(int tx, int ty, const CaveGrid &cells) const {
+	vector<uint8_t> packed(tileSize * tileSize / 8, 0);
+	const uint8_t* in = cells.data();
+	for (size_t i = 0; i < cells.size(); i++) {
+		if (in[i] == Free) { packed[i >> 3] |= (uint8_t)(1 << (i & 7)); }
+	}
+	//Writes to a uniquely named file in the tile directory first, so processes sharing the directory
+	//never write to the same file, and each tile appears whole when renamed into place.
+	string path = tilePath(tx, ty);
+	vector<char> temporary(directory.begin(), directory.end());
+	const char suffix[] = "/tile.XXXXXX";
+	temporary.insert(temporary.end(), suffix, suffix + sizeof(suffix));
+	int descriptor = mkstemp(temporary.data());
+	if (descriptor < 0) { return false; }
+	FILE* file = fdopen(descriptor, "wb");
+	if (!file) {
+		close(descriptor);
+		remove(temporary.data());
+		return false;
+	}
+	bool written = fwrite(packed.data(), 1, packed.size(), file) == packed.size();
+	written = (fclose(file) == 0) && written;
+	if (!written || rename(temporary.data(), path.c_str()) != 0) {
+		remove(temporary.data());
+		return false;
+	}
+	return true;
+}
+
+//Removes the least recently used tile, writing it to disk first if it is not there yet.
+//A tile that cannot be written is simply generated again when next needed.
+void ChunkedCave::evict() {
+	uint64_t k = recentTiles.back();
+	recentTiles.pop_back();
+	Tile &tile = tiles[k];
+	if (!tile.onDisk) {
+		saveTile((int32_t)(k >> 32), (int32_t)(uint32_t)k, tile.cells);
+	}
+	tiles.erase(k);
+}
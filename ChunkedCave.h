@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include "CaveGrid.h"
+#include "CaveGenerator.h"
+#include "Cell.h"
+using namespace std;
+
+//Unbounded cave made of fixed-size square tiles generated on demand from the noise field.
+//Each tile is smoothed together with a halo as wide as the smoothing iterations times the rule radius,
+//so tiles join seamlessly and match smoothing the whole noise field at once.
+//Only the most recently used tiles stay in memory. Older tiles are written to the tile
+//directory and read back when they are needed again, so memory depends on the area in use.
+//Resident tiles are written out by flush and when the cave is destroyed, so later runs reuse them.
+//Each set of parameters keeps its tiles in its own subdirectory of the tile directory.
+//Tiles are generated and evicted as windows of the cave are read, for offline use such as cavegen's
+//windowed output; the drone simulation still explores a bounded cave held whole in memory.
+//Connectivity cleanup needs the whole cave, so chunked caves skip the inaccessible area and
+//occupied pocket removal stages. Not thread safe.
+class ChunkedCave {
+public:
+  static const int tileSize = 64; //Cells along each side of a tile.
+  ChunkedCave(const CaveParams &params, const string &directory, size_t maxResidentTiles);
+  ~ChunkedCave();
+  void flush();
+  uint8_t get(int x, int y);
+  void copyRegion(int x0, int y0, CaveGrid &region);
+  static int tileOf(int x);
+private:
+  struct Tile {
+    CaveGrid cells;
+    list<uint64_t>::iterator recent; //Position in the most recently used list.
+    bool onDisk; //The tile directory already holds this tile.
+  };
+  CaveParams params;
+  string directory;
+  size_t maxResidentTiles;
+  unordered_map<uint64_t, Tile> tiles;
+  list<uint64_t> recentTiles; //Resident tiles, most recently used first.
+  static uint64_t key(int tx, int ty);
+  Tile& fetch(int tx, int ty);
+  Tile& insert(uint64_t k, CaveGrid &cells, bool onDisk);
+  void generateTile(int tx, int ty, CaveGrid &cells) const;
+  string tilePath(int tx, int ty) const;
+  bool loadTile(int tx, int ty, CaveGrid &cells) const;
+  bool saveTile(int tx, int ty, const CaveGrid &cells) const;
+  void evict();
+};
@@ -4,11 +4,13 @@
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <climits>
 #include "Config.h"
 #include "CommunicationMethod.h"
+#include "SenseMethod.h"
 using namespace std;
 
-void Config::readConfig(vector<vector<int>> &presets, CommunicationMethod &method, float &searchR, float &commR) {
+void Config::readConfig(ConfigSettings &settings) {
 
 	ifstream configFile;
 	string configLine;
@@ -17,6 +19,10 @@ void Config::readConfig(vector<vector<int>> &presets, CommunicationMethod &metho
 
 	cout << "Reading Config file..." << endl;
 
+	//The cave size given, kept if the file sets an unusable one.
+	int caveW = settings.caveW;
+	int caveH = settings.caveH;
+
 	while (!configFile.eof()) {
 		lineNumber++;
 		getline(configFile, configLine);
@@ -31,47 +37,73 @@ void Config::readConfig(vector<vector<int>> &presets, CommunicationMethod &metho
 
 		try {
 			if (s == "COMM_METHOD") {
-				if (splitLine[1] == "LOCAL") { method = Local; }
-				if (splitLine[1] == "GLOBAL") { method = Global; }
+				if (splitLine[1] == "LOCAL") { settings.method = Local; }
+				if (splitLine[1] == "GLOBAL") { settings.method = Global; }
+			}
+			else if (s == "SENSE_METHOD") {
+				if (splitLine[1] == "RAYCAST") { settings.sensing = Raycast; }
+				if (splitLine[1] == "SHADOWCAST") { settings.sensing = Shadowcast; }
 			}
-			else if (s == "P1_X") { presets[0][0] = getInt(splitLine[1]); }
-			else if (s == "P1_Y") { presets[0][1] = getInt(splitLine[1]); }
-			else if (s == "P1_FP") { presets[0][2] = getInt(splitLine[1]); }
-			else if (s == "P1_NS") { presets[0][3] = getInt(splitLine[1]); }
-			else if (s == "P1_IT") { presets[0][4] = getInt(splitLine[1]); }
-			else if (s == "P2_X") { presets[1][0] = getInt(splitLine[1]); }
-			else if (s == "P2_Y") { presets[1][1] = getInt(splitLine[1]); }
-			else if (s == "P2_FP") { presets[1][2] = getInt(splitLine[1]); }
-			else if (s == "P2_NS") { presets[1][3] = getInt(splitLine[1]); }
-			else if (s == "P2_IT") { presets[1][4] = getInt(splitLine[1]); }
-			else if (s == "P3_X") { presets[2][0] = getInt(splitLine[1]); }
-			else if (s == "P3_Y") { presets[2][1] = getInt(splitLine[1]); }
-			else if (s == "P3_FP") { presets[2][2] = getInt(splitLine[1]); }
-			else if (s == "P3_NS") { presets[2][3] = getInt(splitLine[1]); }
-			else if (s == "P3_IT") { presets[2][4] = getInt(splitLine[1]); }
-			else if (s == "P4_X") { presets[3][0] = getInt(splitLine[1]); }
-			else if (s == "P4_Y") { presets[3][1] = getInt(splitLine[1]); }
-			else if (s == "P4_FP") { presets[3][2] = getInt(splitLine[1]); }
-			else if (s == "P4_NS") { presets[3][3] = getInt(splitLine[1]); }
-			else if (s == "P4_IT") { presets[3][4] = getInt(splitLine[1]); }
-			else if (s == "P5_X") { presets[4][0] = getInt(splitLine[1]); }
-			else if (s == "P5_Y") { presets[4][1] = getInt(splitLine[1]); }
-			else if (s == "P5_FP") { presets[4][2] = getInt(splitLine[1]); }
-			else if (s == "P5_NS") { presets[4][3] = getInt(splitLine[1]); }
-			else if (s == "P5_IT") { presets[4][4] = getInt(splitLine[1]); }
-			else if (s == "SEARCH_R") { searchR = getInt(splitLine[1]); }
-			else if (s == "COMM_R") { commR = getInt(splitLine[1]); }
+			else if (s == "P1_X") { settings.presets[0][0] = getInt(splitLine[1]); }
+			else if (s == "P1_Y") { settings.presets[0][1] = getInt(splitLine[1]); }
+			else if (s == "P1_FP") { settings.presets[0][2] = getInt(splitLine[1]); }
+			else if (s == "P1_NS") { settings.presets[0][3] = getInt(splitLine[1]); }
+			else if (s == "P1_IT") { settings.presets[0][4] = getInt(splitLine[1]); }
+			else if (s == "P1_SEED") { settings.seeds[0] = getSeed(splitLine[1]); }
+			else if (s == "P2_X") { settings.presets[1][0] = getInt(splitLine[1]); }
+			else if (s == "P2_Y") { settings.presets[1][1] = getInt(splitLine[1]); }
+			else if (s == "P2_FP") { settings.presets[1][2] = getInt(splitLine[1]); }
+			else if (s == "P2_NS") { settings.presets[1][3] = getInt(splitLine[1]); }
+			else if (s == "P2_IT") { settings.presets[1][4] = getInt(splitLine[1]); }
+			else if (s == "P2_SEED") { settings.seeds[1] = getSeed(splitLine[1]); }
+			else if (s == "P3_X") { settings.presets[2][0] = getInt(splitLine[1]); }
+			else if (s == "P3_Y") { settings.presets[2][1] = getInt(splitLine[1]); }
+			else if (s == "P3_FP") { settings.presets[2][2] = getInt(splitLine[1]); }
+			else if (s == "P3_NS") { settings.presets[2][3] = getInt(splitLine[1]); }
+			else if (s == "P3_IT") { settings.presets[2][4] = getInt(splitLine[1]); }
+			else if (s == "P3_SEED") { settings.seeds[2] = getSeed(splitLine[1]); }
+			else if (s == "P4_X") { settings.presets[3][0] = getInt(splitLine[1]); }
+			else if (s == "P4_Y") { settings.presets[3][1] = getInt(splitLine[1]); }
+			else if (s == "P4_FP") { settings.presets[3][2] = getInt(splitLine[1]); }
+			else if (s == "P4_NS") { settings.presets[3][3] = getInt(splitLine[1]); }
+			else if (s == "P4_IT") { settings.presets[3][4] = getInt(splitLine[1]); }
+			else if (s == "P4_SEED") { settings.seeds[3] = getSeed(splitLine[1]); }
+			else if (s == "P5_X") { settings.presets[4][0] = getInt(splitLine[1]); }
+			else if (s == "P5_Y") { settings.presets[4][1] = getInt(splitLine[1]); }
+			else if (s == "P5_FP") { settings.presets[4][2] = getInt(splitLine[1]); }
+			else if (s == "P5_NS") { settings.presets[4][3] = getInt(splitLine[1]); }
+			else if (s == "P5_IT") { settings.presets[4][4] = getInt(splitLine[1]); }
+			else if (s == "P5_SEED") { settings.seeds[4] = getSeed(splitLine[1]); }
+			else if (s == "SEARCH_R") { settings.searchR = getInt(splitLine[1]); }
+			else if (s == "COMM_R") { settings.commR = getInt(splitLine[1]); }
+			else if (s == "CAVE_W") { settings.caveW = getInt(splitLine[1]); }
+			else if (s == "CAVE_H") { settings.caveH = getInt(splitLine[1]); }
+			else if (s == "THREADS") { settings.threads = getInt(splitLine[1]); }
+			else if (s == "NOISE_OCTAVES") { settings.octaves = getInt(splitLine[1]); }
+			else if (s == "NOISE_LACUNARITY") { settings.lacunarity = getFloat(splitLine[1]); }
+			else if (s == "NOISE_PERSISTENCE") { settings.persistence = getFloat(splitLine[1]); }
+			else if (s == "CAVE_CACHE") { settings.cache = getInt(splitLine[1]); }
+			else if (s == "VISIBILITY_CACHE") { settings.visibility = getInt(splitLine[1]); }
+			else if (s == "CA_RULE") { settings.rule = splitLine[1]; }
+			else if (s == "CA_RADIUS") { settings.ruleRadius = getInt(splitLine[1]); }
 		}
 		catch (const invalid_argument &e) {
-			cout << "Invalid argument on Line (" << lineNumber << ")" << endl;
+			cerr << "Invalid argument on Line (" << lineNumber << ")" << endl;
 		}
 		catch (const out_of_range &e) {
-			cout << "Value out of range on Line (" << lineNumber << ")" << endl;
+			cerr << "Value out of range on Line (" << lineNumber << ")" << endl;
 		}
 
 
 	}
 
+	//Cells are indexed by int, so the whole cave must fit within its range.
+	if (settings.caveW <= 0 || settings.caveH <= 0 || (long long)settings.caveW * settings.caveH > INT_MAX) {
+		cerr << "Invalid cave size " << settings.caveW << "x" << settings.caveH << ", using " << caveW << "x" << caveH << "." << endl;
+		settings.caveW = caveW;
+		settings.caveH = caveH;
+	}
+
 	cout << "Config file processed." << endl;
 	configFile.close();
 }
@@ -89,3 +121,11 @@ vector<string> Config::split(const string& s, char delimiter) {
 int Config::getInt(string s) {
 	return stoi(s);
 }
+
+float Config::getFloat(string s) {
+	return stof(s);
+}
+
+uint64_t Config::getSeed(string s) {
+	return stoull(s);
+}
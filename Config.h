@@ -1,13 +1,39 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <cstdint>
 #include "CommunicationMethod.h"
+#include "SenseMethod.h"
 using namespace std;
 
+//Settings held in config.txt, starting at the defaults used for any the file does not set.
+struct ConfigSettings {
+  vector<vector<int>> presets; //Offset x, offset y, fill percentage, noise scale and iterations of each preset.
+  vector<uint64_t> seeds; //Noise seed of each preset, 0 uses the classic noise table and its offsets.
+  CommunicationMethod method; //How drones share their maps.
+  SenseMethod sensing; //Line of sight model used when sensing.
+  float searchR; //Range of localised search.
+  float commR; //Range of inter-drone communication.
+  int caveW; //Number of cells making the width of the cave.
+  int caveH; //Number of cells making the height of the cave.
+  int threads; //Threads used by the generation stages, 0 uses every hardware thread.
+  int octaves; //Octaves of fractal (fBm) noise, 1 uses plain simplex noise.
+  float lacunarity; //Frequency multiplier between successive octaves.
+  float persistence; //Amplitude multiplier between successive octaves.
+  int cache; //Caches generated caves on disk.
+  int visibility; //Precomputes the cells sensed from every free cell of each cave.
+  string rule; //Cellular automata B/S rule used to smooth caves.
+  int ruleRadius; //Neighbourhood radius of the cellular automata rule.
+  ConfigSettings() : presets(5, vector<int>{0, 0, 50, 50, 10}), seeds(5, 0), method(Local), sensing(Raycast), searchR(10.0f), commR(10.0f),
+    caveW(250), caveH(180), threads(0), octaves(1), lacunarity(2.0f), persistence(0.5f), cache(1), visibility(1), rule("B5678/S45678"), ruleRadius(1) {}
+};
+
 class Config {
 public:
-  static void readConfig(vector<vector<int>> &presets, CommunicationMethod &method, float &searchR, float &commR);
+  static void readConfig(ConfigSettings &settings);
 private:
   static vector<string> split(const string& s, char delimiter);
   static int getInt(string s);
+  static float getFloat(string s);
+  static uint64_t getSeed(string s);
 };
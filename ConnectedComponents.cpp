@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <limits>
+#include "ConnectedComponents.h"
+#include "ThreadPool.h"
+using namespace std;
+
+ConnectedComponents::ConnectedComponents() : width(0), height(0) {}
+
+//Finds the root of a provisional label, halving the path on the way.
+int ConnectedComponents::findRoot(vector<int> &parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+//Merges the sets of two provisional labels, keeping the smaller label as the root.
+void ConnectedComponents::unite(vector<int> &parent, int a, int b) {
+	a = findRoot(parent, a);
+	b = findRoot(parent, b);
+	if (a < b) { parent[b] = a; }
+	else if (b < a) { parent[a] = b; }
+}
+
+//Finds the root of a label shared between threads, halving the path on the way.
+//Parents only ever move to an ancestor in the same set, so relaxed ordering is enough.
+int ConnectedComponents::findRoot(atomic<int>* parent, int i) {
+	while (true) {
+		int p = parent[i].load(memory_order_relaxed);
+		if (p == i) { return i; }
+		int grandparent = parent[p].load(memory_order_relaxed);
+		if (p != grandparent) {
+			parent[i].compare_exchange_weak(p, grandparent, memory_order_relaxed);
+		}
+		i = grandparent;
+	}
+}
+
+//Merges the sets of two shared labels, linking the larger root below the smaller one.
+//Retries if another thread links the root first.
+void ConnectedComponents::unite(atomic<int>* parent, int a, int b) {
+	while (true) {
+		a = findRoot(parent, a);
+		b = findRoot(parent, b);
+		if (a == b) { return; }
+		if (a < b) { swap(a, b); }
+		int expected = a;
+		if (parent[a].compare_exchange_strong(expected, b, memory_order_relaxed)) { return; }
+	}
+}
+
+//Labels every cell of the cave with the component it belongs to.
+//Up to the given number of threads label separate tiles (0 uses the whole shared pool).
+void ConnectedComponents::label(const CaveGrid &cave, int threads) {
+	//Tiles are kept to a minimum height so small caves are not split needlessly.
+	const int minTileRows = 64;
+	ThreadPool &pool = ThreadPool::shared();
+	int tiles = (threads <= 0) ? pool.size() : min(threads, pool.size());
+	tiles = max(1, min(tiles, cave.getHeight() / minTileRows));
+
+	if (tiles == 1) {
+		labelSerial(cave);
+	}
+	else {
+		labelTiled(cave, tiles);
+	}
+}
+
+//Labels the cave on the calling thread.
+void ConnectedComponents::labelSerial(const CaveGrid &cave) {
+	width = cave.getWidth();
+	height = cave.getHeight();
+	labels.assign(cave.size(), 0);
+	vector<int> parent;
+	parent.reserve(cave.size() / 4 + 1);
+
+	//First pass: provisional labels from the west and south neighbours, recording equivalences.
+	for (int y = 0; y < height; y++) {
+		const uint8_t* row = cave.row(y);
+		const uint8_t* below = (y > 0) ? cave.row(y - 1) : nullptr;
+		int* rowLabels = labels.data() + (size_t)y * width;
+		int* belowLabels = rowLabels - width;
+		for (int x = 0; x < width; x++) {
+			bool west = x > 0 && row[x - 1] == row[x];
+			bool south = below && below[x] == row[x];
+			if (west && south) {
+				rowLabels[x] = rowLabels[x - 1];
+				unite(parent, rowLabels[x - 1], belowLabels[x]);
+			}
+			else if (west) {
+				rowLabels[x] = rowLabels[x - 1];
+			}
+			else if (south) {
+				rowLabels[x] = belowLabels[x];
+			}
+			else {
+				rowLabels[x] = parent.size();
+				parent.push_back(parent.size());
+			}
+		}
+	}
+
+	//Assigns consecutive component numbers to the roots.
+	vector<int> component(parent.size(), -1);
+	sizes.clear();
+	states.clear();
+	firstCells.clear();
+	for (size_t i = 0; i < parent.size(); i++) {
+		int root = findRoot(parent, i);
+		if (component[root] == -1) {
+			component[root] = sizes.size();
+			sizes.push_back(0);
+			states.push_back(0);
+			firstCells.push_back(Cell(width, height));
+		}
+		component[i] = component[root];
+	}
+
+	//Second pass: final labels, sizes, states and first cells.
+	for (int y = 0; y < height; y++) {
+		const uint8_t* row = cave.row(y);
+		int* rowLabels = labels.data() + (size_t)y * width;
+		for (int x = 0; x < width; x++) {
+			int c = component[rowLabels[x]];
+			rowLabels[x] = c;
+			sizes[c]++;
+			states[c] = row[x];
+			Cell &first = firstCells[c];
+			if (x < first.x || (x == first.x && y < first.y)) {
+				first = Cell(x,y);
+			}
+		}
+	}
+}
+
+//Labels the cave as horizontal tiles of rows on the shared thread pool.
+//Provisional labels are cell indices, so every set's root is its first cell in row-major
+//order and components are numbered in the same order as the serial labelling.
+void ConnectedComponents::labelTiled(const CaveGrid &cave, int tiles) {
+	width = cave.getWidth();
+	height = cave.getHeight();
+	labels.assign(cave.size(), 0);
+	const int w = width;
+	const uint8_t* cells = cave.data();
+	unique_ptr<atomic<int>[]> parent(new atomic<int>[cave.size()]);
+	ThreadPool &pool = ThreadPool::shared();
+	vector<int> tileRows(tiles + 1);
+	for (int t = 0; t <= tiles; t++) {
+		tileRows[t] = (int)((long long)height * t / tiles);
+	}
+
+	//Labels each tile independently. Only the tile's own cells are written.
+	pool.run(tiles, [&](size_t t) {
+		for (int y = tileRows[t]; y < tileRows[t + 1]; y++) {
+			for (int x = 0; x < w; x++) {
+				int i = y * w + x;
+				int p = (x > 0 && cells[i - 1] == cells[i]) ? findRoot(parent.get(), i - 1) : i;
+				parent[i].store(p, memory_order_relaxed);
+				if (y > tileRows[t] && cells[i - w] == cells[i]) {
+					unite(parent.get(), i, i - w);
+				}
+			}
+		}
+	});
+
+	//Merges the equivalences along the seam below each tile concurrently.
+	pool.run(tiles - 1, [&](size_t seam) {
+		int y = tileRows[seam + 1];
+		for (int x = 0; x < w; x++) {
+			int i = y * w + x;
+			if (cells[i - w] == cells[i]) {
+				unite(parent.get(), i, i - w);
+			}
+		}
+	});
+
+	//Resolves every cell to its root and counts the roots in each tile.
+	vector<int> tileRoots(tiles, 0);
+	pool.run(tiles, [&](size_t t) {
+		int roots = 0;
+		for (int i = tileRows[t] * w; i < tileRows[t + 1] * w; i++) {
+			labels[i] = findRoot(parent.get(), i);
+			roots += (labels[i] == i);
+		}
+		tileRoots[t] = roots;
+	});
+
+	//Numbers the components in row-major order of their roots.
+	vector<int> tileOffsets(tiles + 1, 0);
+	for (int t = 0; t < tiles; t++) {
+		tileOffsets[t + 1] = tileOffsets[t] + tileRoots[t];
+	}
+	const int components = tileOffsets[tiles];
+	states.assign(components, 0);
+	unique_ptr<atomic<int>[]> componentSizes(new atomic<int>[components]);
+	unique_ptr<atomic<long long>[]> firstOrder(new atomic<long long>[components]);
+
+	//Roots are no longer needed as parents, so each root's entry now holds its component number.
+	pool.run(tiles, [&](size_t t) {
+		int c = tileOffsets[t];
+		for (int i = tileRows[t] * w; i < tileRows[t + 1] * w; i++) {
+			if (labels[i] == i) {
+				parent[i].store(c, memory_order_relaxed);
+				states[c] = cells[i];
+				componentSizes[c].store(0, memory_order_relaxed);
+				firstOrder[c].store(numeric_limits<long long>::max(), memory_order_relaxed);
+				c++;
+			}
+		}
+	});
+
+	//Final labels, with sizes and first cells accumulated once per run of equal labels in a row.
+	pool.run(tiles, [&](size_t t) {
+		for (int y = tileRows[t]; y < tileRows[t + 1]; y++) {
+			int* rowLabels = labels.data() + (size_t)y * w;
+			int runStart = 0;
+			for (int x = 0; x <= w; x++) {
+				if (x < w) {
+					rowLabels[x] = parent[rowLabels[x]].load(memory_order_relaxed);
+				}
+				if (x == w || (x > runStart && rowLabels[x] != rowLabels[runStart])) {
+					int c = rowLabels[runStart];
+					componentSizes[c].fetch_add(x - runStart, memory_order_relaxed);
+					long long order = (long long)runStart * height + y;
+					long long current = firstOrder[c].load(memory_order_relaxed);
+					while (order < current && !firstOrder[c].compare_exchange_weak(current, order, memory_order_relaxed)) {}
+					runStart = x;
+				}
+			}
+		}
+	});
+
+	sizes.resize(components);
+	firstCells.resize(components);
+	for (int c = 0; c < components; c++) {
+		sizes[c] = componentSizes[c].load(memory_order_relaxed);
+		long long order = firstOrder[c].load(memory_order_relaxed);
+		firstCells[c] = Cell((int)(order / height), (int)(order % height));
+	}
+}
+
+int ConnectedComponents::getLabel(int x, int y) const {
+	return labels[(size_t)y * width + x];
+}
+
+int ConnectedComponents::getComponentCount() const {
+	return sizes.size();
+}
+
+int ConnectedComponents::getSize(int component) const {
+	return sizes[component];
+}
+
+uint8_t ConnectedComponents::getState(int component) const {
+	return states[component];
+}
+
+Cell ConnectedComponents::getFirstCell(int component) const {
+	return firstCells[component];
+}
+
+const vector<int>& ConnectedComponents::getLabels() const {
+	return labels;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include "CaveGrid.h"
+#include "Cell.h"
+using namespace std;
+
+//Labels the 4-connected regions of equal state (free and occupied alike) in a cave
+//using a single union-find pass, recording the size and state of every component.
+//Large caves are split into tiles of rows labelled on separate threads, whose seams
+//are then merged through a lock-free union-find.
+class ConnectedComponents {
+public:
+  ConnectedComponents();
+  void label(const CaveGrid &cave, int threads);
+  int getLabel(int x, int y) const;
+  int getComponentCount() const;
+  int getSize(int component) const;
+  uint8_t getState(int component) const;
+  Cell getFirstCell(int component) const;
+  const vector<int>& getLabels() const;
+private:
+  int width;
+  int height;
+  vector<int> labels; //Component of each cell, row-major.
+  vector<int> sizes; //Number of cells in each component.
+  vector<uint8_t> states; //Cell state shared by each component.
+  vector<Cell> firstCells; //First cell of each component scanning columns left to right, each bottom to top.
+  static int findRoot(vector<int> &parent, int i);
+  static void unite(vector<int> &parent, int a, int b);
+  static int findRoot(atomic<int>* parent, int i);
+  static void unite(atomic<int>* parent, int a, int b);
+  void labelSerial(const CaveGrid &cave);
+  void labelTiled(const CaveGrid &cave, int tiles);
+};
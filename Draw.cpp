@@ -224,15 +224,15 @@ void Draw::drawDroneSearchingRange(float searchRadius, float depth) {
 }
 
 //Draws discovered cave cells in a specific colour to indicate type.
-void Draw::drawDiscoveredCells(int caveWidth, int caveHeight, float depth, vector<vector<int>> cave, float colours[][4], map<int,int> frontierCells, bool showCommFrontiers) {
-	//Iterates over each cell in the cave.
-	for (size_t i = 0; i < caveWidth; i++) {
-		for (size_t j = 0; j < caveHeight; j++) {
+void Draw::drawDiscoveredCells(int caveWidth, int caveHeight, float depth, const CaveGrid &cave, float colours[][4], const FrontierSet &frontierCells, bool showCommFrontiers) {
+	//Iterates over each cell in the cave, row by row as the map is stored.
+	for (size_t j = 0; j < caveHeight; j++) {
+		for (size_t i = 0; i < caveWidth; i++) {
 			float d;
 			//Skip the cell if it is unknown.
-			if (cave[i][j] == Unknown) { continue; }
+			if (cave(i, j) == Unknown) { continue; }
 			glPushMatrix();
-			switch (cave[i][j]) {
+			switch (cave(i, j)) {
 				case Free:
 					glColor4fv(colours[0]);
 					d = depth;
@@ -242,8 +242,9 @@ void Draw::drawDiscoveredCells(int caveWidth, int caveHeight, float depth, vecto
 					d = 0.0f;
 					break;
 				case Frontier:
+					//Frontiers at timestep 0 came from another drone.
 					int cellID = j * caveWidth + i;
-					if (showCommFrontiers && frontierCells[cellID] == 0) {
+					if (showCommFrontiers && (!frontierCells.contains(cellID) || frontierCells.getTimestepOf(cellID) == 0)) {
 						glColor4f(0.4f, 0.4f, 0.1f, 1.0f); //Communicated Frontier
 					}
 					else {
@@ -4,6 +4,8 @@
 #include "SenseCell.h"
 #include "DroneConfig.h"
 #include "Cell.h"
+#include "CaveGrid.h"
+#include "FrontierSet.h"
 using namespace std;
 
 class Draw {
@@ -12,7 +14,7 @@ public:
   static void drawBorder(float depth, float caveWidth, float caveHeight);
   static void drawText(int x, int y, float scale, const char* text, const float* textColour);
   static void drawDrone(float x, float y, float depth, float searchRadius, string name, float bearing, Cell currentTarget, bool showTarget);
-  static void drawDiscoveredCells(int caveWidth, int caveHeight, float depth, vector<vector<int>> cave, float colours[][4], map<int,int> frontierCells, bool showCommFrontiers);
+  static void drawDiscoveredCells(int caveWidth, int caveHeight, float depth, const CaveGrid &cave, float colours[][4], const FrontierSet &frontierCells, bool showCommFrontiers);
   static void drawDronePath(vector<DroneConfig> pathList, float depth, float radius, const float mask[3]);
 private:
   static void drawDroneBoundingBox(float depth);
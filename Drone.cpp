@@ -16,17 +16,22 @@
 #include "SenseCell.h"
 #include "DroneConfig.h"
 #include "MapCell.h"
+#include "CaveGrid.h"
+#include "FieldOfView.h"
 #include "Drone.h"
+#include "ThreadPool.h"
 using namespace std;
 
 //Static Data Members.
 float Drone::searchRadius = 10.0f; //Range of localised search.
 float Drone::communicationRadius = 10.0f; //Range of inter-drone communication.
 int Drone::communicationTimeBuffer = 25; //Minimum number of timesteps required between communication.
+SenseMethod Drone::senseMethod = Raycast; //Line of sight model used when sensing.
 
 int Drone::caveWidth;
 int Drone::caveHeight;
-vector<vector<int>> Drone::cave;
+CaveGrid Drone::cave;
+VisibilityCache Drone::visibility;
 int Drone::droneCount;
 
 //Data Members.
@@ -36,8 +41,8 @@ float posX; //Current x position in the cave.
 float posY; //Current y position in the cave.
 float bearing; //0 -> Facing North.
 bool complete; //Has finished exploration.
-vector<vector<int>> internalMap; //Drone's identified cells of the cave.
-map<int,int> frontierCells; //Free cells that are adjacent to unknowns.
+CaveGrid internalMap; //Drone's identified cells of the cave.
+FrontierSet frontierCells; //Free cells that are adjacent to unknowns.
 vector<DroneConfig> pathList; //List of drone configurations for each timestep.
 int currentTimestep; //Current timestep used to mark when frontiers were last identified.
 pair<Cell,int> currentTarget; //Cell the drone is navigating to and the timestep in which it was identified.
@@ -54,18 +59,18 @@ int commFreeCount; //Number of free cells recieved from inter-drone communicatio
 int commOccupiedCount; //Number of occupied cells recieved from inter-drone communication.
 
 
-//Less than comparison function for two SenseCell objects.
-bool operator <(const SenseCell& a, const SenseCell& b) {
-  return a.range < b.range;
-}
-
 //Sets static cave properties.
-void Drone::setParams(int _caveWidth, int _caveHeight, vector<vector<int>> _cave) {
-  caveWidth = _caveWidth;
-  caveHeight = _caveHeight;
+void Drone::setParams(const CaveGrid& _cave) {
+  caveWidth = _cave.getWidth();
+  caveHeight = _cave.getHeight();
   cave = _cave;
 }
 
+//Takes over the precomputed visibility of the cave, which sensing uses while it covers the search radius and method.
+void Drone::setVisibility(VisibilityCache& _visibility) {
+  swap(visibility, _visibility);
+}
+
 //Initalises the drone's starting position, name and internal map.
 void Drone::init(int _id, float x, float y, string _name) {
   //Set given parameters.
@@ -83,7 +88,8 @@ void Drone::init(int _id, float x, float y, string _name) {
   commFreeCount = 0;
   commOccupiedCount = 0;
   hasCommunicated = false;
-  frontierCells.clear(); //Clears the frontier cells.
+  senseAll = true;
+  frontierCells.resize(caveWidth, caveHeight); //Clears the frontier cells.
   pathList.clear();
   targetPath.clear();
   currentTarget = make_pair(Cell(-1,-1), -1); //Unreachable default target.
@@ -94,19 +100,12 @@ void Drone::init(int _id, float x, float y, string _name) {
   }
 
   //Sets the internal map to all unknowns.
-  internalMap.clear();
-  for (size_t i = 0; i < caveWidth; i++) {
-    vector<int> column;
-    for (size_t j = 0; j < caveHeight; j++) {
-      column.push_back(Unknown);
-    }
-    internalMap.push_back(column);
-  }
+  internalMap.resize(caveWidth, caveHeight, Unknown);
 
   //Initial sense and target.
-  pair<vector<SenseCell>,vector<SenseCell>> buffers = sense();
-  updateInternalMap(buffers.first, buffers.second);
-  findFrontierCells(buffers.first, buffers.second);
+  sense();
+  updateInternalMap();
+  findFrontierCells();
   getNewTarget();
   recordConfiguration(); //Records the initial drone configuration.
 }
@@ -123,113 +122,109 @@ void Drone::setPosition(float x, float y) {
 }
 
 //Models the sensing of the immediate local environment accounting for obstacles blocking sense view.
-pair<vector<SenseCell>,vector<SenseCell>> Drone::sense() {
-
-  vector<SenseCell> candidates; //List of candidate cells.
-  vector<SenseCell> freeCells; //List of found free cells.
-  vector<SenseCell> occupiedCells; //List of found occupied cells.
-  vector<SenseCell> checkCells; //List of cells to check.
-
-  //For each cell in the bounding box of the search range.
-  //Discards Out-of-bounds cells (e.g. i = -1).
-  for (size_t i = max(0, (int)floor(posX - searchRadius)); i <= min(caveWidth - 1, (int)ceil(posX + searchRadius)); i++) {
-    for (size_t j = max(0, (int)floor(posY - searchRadius)); j <= min(caveHeight - 1, (int)ceil(posY + searchRadius)); j++) {
-      //Allows only cells in the range.
-      float range = getDistToDrone((float)i, (float)j);
-      if (range > searchRadius) { continue; }
-      //Push the candidate cell onto the vector.
-      candidates.push_back(SenseCell(i,j,range));
-    }
-  }
+//Drones sit on cell centres, which shadowcasting and the precomputed visibility start from.
+//Returns only the sensed cells that can change the internal map: those that came into view since the
+//previous sense, and visible cells that are or border frontiers, as sensing them refreshes the frontiers.
+//Everything in view is returned when senseAll is set, after the internal map changed by other means.
+//The cells are left in the sense buffers, whose storage is reused from one timestep to the next.
+void Drone::sense() {
 
-  //Sorts the list of cells by distance to the drone in increasing order.
-  sort(candidates.begin(), candidates.end());
+  int x = (int)lround(posX);
+  int y = (int)lround(posY);
 
-  //Check to make sure you can't sense objects hidden behind something else.
-  for (auto const& dest : candidates) {
-    //If the cell range is 1 or less then immediately add it to the list.
-    if (dest.range <= 1) {
-      if (cave[dest.x][dest.y] == Free) {
-        freeCells.push_back(dest);
-      }
-      else {
-        occupiedCells.push_back(dest);
-        checkCells.push_back(dest);
-      }
-      continue;
+  //Cells in view as runs relative to the drone, read from the precomputed visibility when it applies.
+  if (!(visibility.covers(cave, searchRadius, senseMethod) && visibility.getRuns(x, y, senseRuns))) {
+    if (senseMethod == Shadowcast) {
+      fieldOfView.shadowcast(cave, x, y, searchRadius, freeCellBuffer, occupiedCellBuffer);
     }
-
-    bool collisionDetected = false; //If an occupied cell blocks the path from the drone to the cell to be checked.
-
-    //Obstacle in line of sight between drone position and destination cell check.
-    for (auto const& occupyCheck : checkCells) {
-      //Ignore if the cell to check is free.
-      if (cave[occupyCheck.x][occupyCheck.y] == Free) { continue; }
-
-      float xDiff = dest.x - posX;
-      float yDiff = dest.y - posY;
-      float tx0 = (occupyCheck.x - 0.5f - posX) / xDiff;
-      float tx1 = (occupyCheck.x + 0.5f - posX) / xDiff;
-      float ty0 = (occupyCheck.y - 0.5f - posY) / yDiff;
-      float ty1 = (occupyCheck.y + 0.5f - posY) / yDiff;
-
-      if (tx0 >= 0 && tx0 <= 1) {
-        float yCheck = posY + tx0 * yDiff;
-        if (yCheck >= occupyCheck.y - 0.5f && yCheck <= occupyCheck.y + 0.5f) {
-          collisionDetected = true;
-          break;
-        }
-      }
-      if (tx1 >= 0 && tx1 <= 1) {
-        float yCheck = posY + tx1 * yDiff;
-        if (yCheck >= occupyCheck.y - 0.5f && yCheck <= occupyCheck.y + 0.5f) {
-          collisionDetected = true;
-          break;
-        }
+    else {
+      fieldOfView.raycast(cave, posX, posY, searchRadius, freeCellBuffer, occupiedCellBuffer);
+    }
+    senseRuns.clear();
+    VisibilityCache::toRuns(freeCellBuffer, occupiedCellBuffer, x, y, searchRadius, senseRuns, senseScratch);
+  }
+  freeCellBuffer.clear();
+  occupiedCellBuffer.clear();
+
+  auto add = [&](int cx, int cy) {
+    SenseCell sensed(cx, cy, FieldOfView::distance(cx, cy, x, y));
+    if (cave(cx, cy) == Free) { freeCellBuffer.push_back(sensed); }
+    else { occupiedCellBuffer.push_back(sensed); }
+  };
+
+  if (senseAll) {
+    for (auto const& run : senseRuns) {
+      for (int dx = run.dx; dx < run.dx + run.length; dx++) {
+        add(x + dx, y + run.dy);
       }
-      if (ty0 >= 0 && ty0 <= 1) {
-        float xCheck = posX + ty0 * xDiff;
-        if (xCheck >= occupyCheck.x - 0.5f && xCheck <= occupyCheck.x + 0.5f) {
-          collisionDetected = true;
-          break;
+    }
+  }
+  else {
+    //Cells coming into view: each run less the previous runs on the same row, shifted to this position.
+    int shiftX = visibleX - x;
+    int shiftY = visibleY - y;
+    size_t rowFirst = 0;
+    for (auto const& run : senseRuns) {
+      while (rowFirst < visibleRuns.size() && visibleRuns[rowFirst].dy + shiftY < run.dy) { rowFirst++; }
+      int start = run.dx;
+      int end = run.dx + run.length;
+      for (size_t r = rowFirst; r < visibleRuns.size() && visibleRuns[r].dy + shiftY == run.dy && start < end; r++) {
+        int seenStart = visibleRuns[r].dx + shiftX;
+        int seenEnd = seenStart + visibleRuns[r].length;
+        if (seenEnd <= start) { continue; }
+        if (seenStart >= end) { break; }
+        for (int dx = start; dx < seenStart; dx++) {
+          add(x + dx, y + run.dy);
         }
+        start = max(start, seenEnd);
       }
-      if (ty1 >= 0 && ty0 <= 1) {
-        float xCheck = posX + ty1 * xDiff;
-        if (xCheck >= occupyCheck.x - 0.5f && xCheck <= occupyCheck.x + 0.5f) {
-          collisionDetected = true;
-          break;
-        }
+      for (int dx = start; dx < end; dx++) {
+        add(x + dx, y + run.dy);
       }
     }
 
-    //If no collision detected then the destination cell is in line of sight from the drone's position.
-    if (!collisionDetected) {
-      if (cave[dest.x][dest.y] == Free) {
-        freeCells.push_back(dest);
-      }
-      else {
-        occupiedCells.push_back(dest);
-        checkCells.push_back(dest);
-      }
+    //Frontiers within one cell of the search radius that are in view or border a cell in view.
+    const int reach = (int)floor(searchRadius);
+    senseRowStart.assign(2 * reach + 2, 0);
+    for (auto const& run : senseRuns) {
+      senseRowStart[run.dy + reach + 1]++;
     }
-    else {
-      checkCells.push_back(dest);
+    for (size_t i = 1; i < senseRowStart.size(); i++) {
+      senseRowStart[i] += senseRowStart[i-1];
     }
+    auto inView = [&](int cx, int cy) {
+      int dx = cx - x;
+      int dy = cy - y;
+      if (dy < -reach || dy > reach) { return false; }
+      for (int r = senseRowStart[dy + reach]; r < senseRowStart[dy + reach + 1]; r++) {
+        if (dx >= senseRuns[r].dx && dx < senseRuns[r].dx + senseRuns[r].length) { return true; }
+      }
+      return false;
+    };
+    frontierCells.forEachInRadius(x, y, searchRadius + 1.0f, [&](int fx, int fy) {
+      if (inView(fx, fy)) { add(fx, fy); }
+      if (inView(fx - 1, fy)) { add(fx - 1, fy); }
+      if (inView(fx + 1, fy)) { add(fx + 1, fy); }
+      if (inView(fx, fy - 1)) { add(fx, fy - 1); }
+      if (inView(fx, fy + 1)) { add(fx, fy + 1); }
+    });
   }
 
-  return make_pair(freeCells, occupiedCells);
+  visibleRuns.swap(senseRuns);
+  visibleX = x;
+  visibleY = y;
+  senseAll = false;
 }
 
 //Updates the internal map of the drone to include recently sensed free and occupied cells.
-void Drone::updateInternalMap(vector<SenseCell> freeCellBuffer, vector<SenseCell> occupiedCellBuffer) {
+void Drone::updateInternalMap() {
 
   //Adds all free cells to the internal map.
   for (auto const& freeCell : freeCellBuffer) {
     int x = freeCell.x;
     int y = freeCell.y;
-    if (internalMap[x][y] == Unknown) {
-      internalMap[x][y] = Free;
+    if (internalMap(x, y) == Unknown) {
+      internalMap(x, y) = Free;
       freeCount++;
     }
   }
@@ -237,46 +232,46 @@ void Drone::updateInternalMap(vector<SenseCell> freeCellBuffer, vector<SenseCell
   for (auto const& occupyCell : occupiedCellBuffer) {
     int x = occupyCell.x;
     int y = occupyCell.y;
-    if (internalMap[x][y] == Unknown) {
-      internalMap[x][y] = Occupied;
+    if (internalMap(x, y) == Unknown) {
+      internalMap(x, y) = Occupied;
       occupiedCount++;
     }
   }
 }
 
 //Recalculates the set of frontier cells in the internal map.
-void Drone::findFrontierCells(vector<SenseCell> freeCellBuffer, vector<SenseCell> occupiedCellBuffer) {
+void Drone::findFrontierCells() {
 
   //List of cells to check if they are frontier cels.
   vector<Cell> frontierCheck;
 
   //Iterates through each newly sensed free cell.
   //If the cell itself or a neighbour is a frontier cell, add it to the check list and set it to free.
-  for (vector<SenseCell>::iterator freeCell = freeCellBuffer.begin(); freeCell != freeCellBuffer.end(); ++freeCell) {
+  for (vector<SenseCell>::const_iterator freeCell = freeCellBuffer.begin(); freeCell != freeCellBuffer.end(); ++freeCell) {
     int x = freeCell->x;
     int y = freeCell->y;
     int i = y * caveWidth + x; //Dictionary key for the cell mapped into 1D.
-    if (internalMap[x][y] == Frontier) {
-      internalMap[x][y] = Free;
+    if (internalMap(x, y) == Frontier) {
+      internalMap(x, y) = Free;
       frontierCells.erase(i);
     }
-    if (x - 1 >= 0 && internalMap[x-1][y] == Frontier) {
-      internalMap[x-1][y] = Free;
+    if (x - 1 >= 0 && internalMap(x-1, y) == Frontier) {
+      internalMap(x-1, y) = Free;
       frontierCells.erase(i-1);
       frontierCheck.push_back(Cell(x-1,y));
     }
-    if (x + 1 < caveWidth && internalMap[x+1][y] == Frontier) {
-      internalMap[x+1][y] = Free;
+    if (x + 1 < caveWidth && internalMap(x+1, y) == Frontier) {
+      internalMap(x+1, y) = Free;
       frontierCells.erase(i+1);
       frontierCheck.push_back(Cell(x+1,y));
     }
-    if (y - 1 >= 0 && internalMap[x][y-1] == Frontier) {
-      internalMap[x][y-1] = Free;
+    if (y - 1 >= 0 && internalMap(x, y-1) == Frontier) {
+      internalMap(x, y-1) = Free;
       frontierCells.erase(i-caveWidth);
       frontierCheck.push_back(Cell(x,y-1));
     }
-    if (y + 1 < caveHeight && internalMap[x][y+1] == Frontier) {
-      internalMap[x][y+1] = Free;
+    if (y + 1 < caveHeight && internalMap(x, y+1) == Frontier) {
+      internalMap(x, y+1) = Free;
       frontierCells.erase(i+caveWidth);
       frontierCheck.push_back(Cell(x,y+1));
     }
@@ -285,60 +280,68 @@ void Drone::findFrontierCells(vector<SenseCell> freeCellBuffer, vector<SenseCell
 
   //Iterates through each newly sensed occupied cell.
   //If a neighbour is a frontier cell, add it to the check list and set it to free.
-  for (vector<SenseCell>::iterator occupyCell = occupiedCellBuffer.begin(); occupyCell != occupiedCellBuffer.end(); ++occupyCell) {
+  for (vector<SenseCell>::const_iterator occupyCell = occupiedCellBuffer.begin(); occupyCell != occupiedCellBuffer.end(); ++occupyCell) {
     int x = occupyCell->x;
     int y = occupyCell->y;
     int i = y * caveWidth + x; //Dictionary key for the cell mapped into 1D.
-    if (x - 1 >= 0 && internalMap[x-1][y] == Frontier) {
-      internalMap[x-1][y] = Free;
+    if (x - 1 >= 0 && internalMap(x-1, y) == Frontier) {
+      internalMap(x-1, y) = Free;
       frontierCells.erase(i-1);
       frontierCheck.push_back(Cell(x-1,y));
     }
-    if (x + 1 < caveWidth && internalMap[x+1][y] == Frontier) {
-      internalMap[x+1][y] = Free;
+    if (x + 1 < caveWidth && internalMap(x+1, y) == Frontier) {
+      internalMap(x+1, y) = Free;
       frontierCells.erase(i+1);
       frontierCheck.push_back(Cell(x+1,y));
     }
-    if (y - 1 >= 0 && internalMap[x][y-1] == Frontier) {
-      internalMap[x][y-1] = Free;
+    if (y - 1 >= 0 && internalMap(x, y-1) == Frontier) {
+      internalMap(x, y-1) = Free;
       frontierCells.erase(i-caveWidth);
       frontierCheck.push_back(Cell(x,y-1));
     }
-    if (y + 1 < caveHeight && internalMap[x][y+1] == Frontier) {
-      internalMap[x][y+1] = Free;
+    if (y + 1 < caveHeight && internalMap(x, y+1) == Frontier) {
+      internalMap(x, y+1) = Free;
       frontierCells.erase(i+caveWidth);
       frontierCheck.push_back(Cell(x,y+1));
     }
   }
 
   //For each cell to check if it neighbours an unknown cell set it as a Frontier cell and add it to the list of frontiers.
+  removeRepeatedCells(frontierCheck);
   for (vector<Cell>::iterator frontierCell = frontierCheck.begin(); frontierCell != frontierCheck.end(); ++frontierCell) {
     int x = frontierCell->x;
     int y = frontierCell->y;
     int i = y * caveWidth + x; //Dictionary key for the cell mapped into 1D.
-    if (x - 1 >= 0 && internalMap[x-1][y] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = currentTimestep;
+    if (x - 1 >= 0 && internalMap(x-1, y) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, currentTimestep);
       continue;
     }
-    if (x + 1 < caveWidth && internalMap[x+1][y] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = currentTimestep;
+    if (x + 1 < caveWidth && internalMap(x+1, y) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, currentTimestep);
       continue;
     }
-    if (y - 1 >= 0 && internalMap[x][y-1] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = currentTimestep;
+    if (y - 1 >= 0 && internalMap(x, y-1) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, currentTimestep);
       continue;
     }
-    if (y + 1 < caveHeight && internalMap[x][y+1] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = currentTimestep;
+    if (y + 1 < caveHeight && internalMap(x, y+1) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, currentTimestep);
       continue;
     }
   }
 }
 
+//Removes repeats from a list of cells to check, leaving the cells in index order.
+//Checking a cell has the same effect whenever it is done, so each need only be checked once.
+void Drone::removeRepeatedCells(vector<Cell> &cells) {
+  sort(cells.begin(), cells.end(), [](const Cell &a, const Cell &b) { return a.y * caveWidth + a.x < b.y * caveWidth + b.x; });
+  cells.erase(unique(cells.begin(), cells.end(), [](const Cell &a, const Cell &b) { return a.x == b.x && a.y == b.y; }), cells.end());
+}
+
 //Adds a drone position to the near drones vector.
 void Drone::addNearDrone(float x, float y) {
   nearDrones.push_back(make_pair(x,y));
@@ -383,17 +386,18 @@ void Drone::getFrontierCellStats(float &minTs, float &maxTs, float &minDist, flo
   float distanceSum = 0.0f;
 
   //Gets the maximum timestep and minimum distance in the frontier cell list.
-  for(auto& frontier : frontierCells) {
+  for (size_t k = 0; k < frontierCells.size(); k++) {
+    int frontierTs = frontierCells.getTimestep(k);
     //Updates minimum timestep if the frontier's timestep is lower.
-    if (frontier.second < minTs) {
-      minTs = frontier.second;
+    if (frontierTs < minTs) {
+      minTs = frontierTs;
     }
     //Updates maximum timestep if the frontier's timestep is greater.
-    if (frontier.second > maxTs) {
-      maxTs = frontier.second;
+    if (frontierTs > maxTs) {
+      maxTs = frontierTs;
     }
     //Updates the minimum distance if the frontier's distance is less.
-    Cell frontierCell = intToCell(frontier.first);
+    Cell frontierCell(frontierCells.getX(k), frontierCells.getY(k));
     float frontierDistance = getDistToDrone(frontierCell);
     if (frontierDistance < minDist) {
       minDist = frontierDistance;
@@ -410,8 +414,8 @@ void Drone::getFrontierCellStats(float &minTs, float &maxTs, float &minDist, flo
   float distanceSqSum = 0.0f;
 
   //Gets the variance of the distance.
-  for(auto& frontier : frontierCells) {
-    Cell frontierCell = intToCell(frontier.first);
+  for (size_t k = 0; k < frontierCells.size(); k++) {
+    Cell frontierCell(frontierCells.getX(k), frontierCells.getY(k));
     float frontierDistance = getDistToDrone(frontierCell);
     distanceSqSum += pow(frontierDistance - distanceMean, 2.0f);
   }
@@ -420,6 +424,10 @@ void Drone::getFrontierCellStats(float &minTs, float &maxTs, float &minDist, flo
 }
 
 //Finds the best frontier cell to navigate to.
+//Frontiers are chosen at random in proportion to their weights by giving each the key log(u) / weight,
+//with u uniform in (0, 1), and taking the largest. u is hashed from the cell index and a single random
+//draw, so the choice does not depend on the order the frontiers are held in. Equal keys, such as when
+//every weight is zero, go to the lowest cell index.
 pair<Cell,int> Drone::getBestFrontier(vector<pair<float,float>> nearDroneWeightMap) {
 
   if (nearDroneWeightMap.size() == 0) {
@@ -432,13 +440,15 @@ pair<Cell,int> Drone::getBestFrontier(vector<pair<float,float>> nearDroneWeightM
   float maxDist = 0.0f;
   getFrontierCellStats(minTs, maxTs, minDist, maxDist);
 
-  vector<tuple<Cell,int,float>> cellWeightVector;
-  float cumulativeWeight = 0.0f;
+  uint64_t draw = (uint64_t)rand();
+  pair<Cell,int> best;
+  int bestCell = -1;
+  double bestKey = 0.0;
 
-  for(auto& frontier : frontierCells) {
-    int frontierTs = frontier.second;
+  for (size_t k = 0; k < frontierCells.size(); k++) {
+    int frontierTs = frontierCells.getTimestep(k);
 
-    Cell frontierCell = intToCell(frontier.first);
+    Cell frontierCell(frontierCells.getX(k), frontierCells.getY(k));
     float frontierDistance = getDistToDrone(frontierCell);
     float frontierBearing = atan2(frontierCell.x - posX, frontierCell.y - posY);
     if (frontierBearing < 0.0f) {
@@ -478,73 +488,49 @@ pair<Cell,int> Drone::getBestFrontier(vector<pair<float,float>> nearDroneWeightM
 
     float weight = pow(distWeight, 1.0f) * pow(tsWeight, 2.0f) * pow(bearingWeight, 1.0f);
 
-    cumulativeWeight += weight;
-    cellWeightVector.push_back(make_tuple(frontierCell, frontierTs, cumulativeWeight));
-  }
-
-
-  float randWeight = static_cast<float>(rand())/(static_cast<float>(RAND_MAX/cumulativeWeight));
-
-  for(auto& frontier : cellWeightVector) {
-    Cell c; int ts; float w;
-    tie(c,ts,w) = frontier;
-    if (randWeight <= w) {
-      return make_pair(c,ts);
+    int cell = frontierCell.y * caveWidth + frontierCell.x;
+    double key = log(cellUniform(draw, cell)) / weight;
+    if (bestCell < 0 || key > bestKey || (key == bestKey && cell < bestCell)) {
+      best = make_pair(frontierCell, frontierTs);
+      bestCell = cell;
+      bestKey = key;
     }
   }
+  return best;
 }
 
+//Uniform value in (0, 1) hashed from a random draw and a cell index with the SplitMix64 finaliser.
+double Drone::cellUniform(uint64_t draw, int cell) {
+  uint64_t z = draw * 0x9e3779b97f4a7c15ULL + (uint64_t)(uint32_t)cell;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return ((z >> 11) + 0.5) / 9007199254740992.0;
+}
+
+
 //Gets the latest frontier cell added to the frontier list.
+//Of the frontiers with the latest timestep, the nearest to the drone is chosen.
 pair<Cell,int> Drone::getLatestFrontier() {
 
-  int maxTimestep = 0;
-
   //Gets the maximum timestep in the frontier cell list.
-  for(auto& frontier : frontierCells) {
-    if (frontier.second > maxTimestep) {
-      maxTimestep = frontier.second;
-    }
-  }
+  int maxTimestep = max(0, frontierCells.getLatestTimestep());
 
-  float bestDistance = numeric_limits<float>::max();
-  Cell bestFrontier;
-  int ts;
-
-  //Gets all the frontiers which have the maximum timestep.
-  for(auto& frontier : frontierCells) {
-    if (frontier.second == maxTimestep) {
-      Cell a = intToCell(frontier.first);
-      float dist = getDistToDrone(a);
-      if (dist < bestDistance) {
-        bestDistance = dist;
-        bestFrontier = a;
-        ts = frontier.second;
-      }
-    }
+  //Gets the nearest of the frontiers which have the maximum timestep.
+  int nearest = frontierCells.nearest(posX, posY, maxTimestep, [this](int x, int y) { return getDistToDrone(Cell(x,y)); });
+  if (nearest < 0) {
+    return make_pair(Cell(), maxTimestep);
   }
-
-  return make_pair(bestFrontier, ts);
+  return make_pair(intToCell(nearest), maxTimestep);
 }
 
 //Gets the nearest frontier cell to the drone's current position.
 pair<Cell,int> Drone::getNearestFrontier() {
-  float bestDist = numeric_limits<float>::max();
-  Cell bestFrontier;
-  int timestep;
-
-  //Iterates over every frontier cell to find the frontier nearest to the current drone position.
-  for(auto& frontier : frontierCells) {
-    int y = (int)frontier.first / caveWidth;
-    int x = frontier.first % caveWidth;
-    float dist = getDistToDrone(x, y);
-    if (dist < bestDist) {
-      bestDist = dist;
-      bestFrontier = Cell(x,y);
-      timestep = frontier.second;
-    }
+  int nearest = frontierCells.nearest(posX, posY, INT_MIN, [this](int x, int y) { return getDistToDrone(x, y); });
+  if (nearest < 0) {
+    return make_pair(Cell(), 0);
   }
-
-  return make_pair(bestFrontier, timestep);
+  return make_pair(intToCell(nearest), frontierCells.getTimestepOf(nearest));
 }
 
 //Adds the drone's current configuration to the path.
@@ -672,14 +658,14 @@ vector<Cell> Drone::searchAStar(Cell start, Cell dest) {
     vector<Cell> neighbours;
     int x = current.x;
     int y = current.y;
-    bool left = x - 1 >= 0 && (internalMap[x-1][y] == Free || internalMap[x-1][y] == Frontier);
-    bool right = x + 1 < caveWidth && (internalMap[x+1][y] == Free || internalMap[x+1][y] == Frontier);
-    bool bottom = y - 1 >= 0 && (internalMap[x][y-1] == Free || internalMap[x][y-1] == Frontier);
-    bool top = y + 1 < caveHeight && (internalMap[x][y+1] == Free || internalMap[x][y+1] == Frontier);
-    bool bottomleft = bottom && left && (internalMap[x-1][y-1] == Free || internalMap[x-1][y-1] == Frontier);
-    bool bottomright = bottom && right && (internalMap[x+1][y-1] == Free || internalMap[x+1][y-1] == Frontier);
-    bool topleft = top && left && (internalMap[x-1][y+1] == Free || internalMap[x-1][y+1] == Frontier);
-    bool topright = top && right && (internalMap[x+1][y+1] == Free || internalMap[x+1][y+1] == Frontier);
+    bool left = x - 1 >= 0 && (internalMap(x-1, y) == Free || internalMap(x-1, y) == Frontier);
+    bool right = x + 1 < caveWidth && (internalMap(x+1, y) == Free || internalMap(x+1, y) == Frontier);
+    bool bottom = y - 1 >= 0 && (internalMap(x, y-1) == Free || internalMap(x, y-1) == Frontier);
+    bool top = y + 1 < caveHeight && (internalMap(x, y+1) == Free || internalMap(x, y+1) == Frontier);
+    bool bottomleft = bottom && left && (internalMap(x-1, y-1) == Free || internalMap(x-1, y-1) == Frontier);
+    bool bottomright = bottom && right && (internalMap(x+1, y-1) == Free || internalMap(x+1, y-1) == Frontier);
+    bool topleft = top && left && (internalMap(x-1, y+1) == Free || internalMap(x-1, y+1) == Frontier);
+    bool topright = top && right && (internalMap(x+1, y+1) == Free || internalMap(x+1, y+1) == Frontier);
 
     //Left Neighbour.
     if (left) { neighbours.push_back(Cell(x-1,y)); }
@@ -727,23 +713,44 @@ vector<Cell> Drone::searchAStar(Cell start, Cell dest) {
 
 //Processes the drone's movement, sensing, frontier identification and selection for one timestep.
 void Drone::process() {
+  if (move()) {
+    observe();
+  }
+}
+
+//Processes every incomplete drone for one timestep, as calling process on each in turn does.
+//Drones move and choose targets one after another, as choosing reads the communication state they
+//share, then sense in parallel on the shared thread pool, as sensing only touches the drone's own map.
+void Drone::processAll(vector<Drone> &drones) {
+  vector<Drone*> moved;
+  for (auto& drone : drones) {
+    if (!drone.complete && drone.move()) {
+      moved.push_back(&drone);
+    }
+  }
+  ThreadPool::shared().run(moved.size(), [&](size_t i) { moved[i]->observe(); });
+}
+
+//Moves the drone towards its target, or chooses a new one if it has been reached or the map was merged.
+//Returns false if the drone does not sense this timestep, as it is waiting to start or has finished.
+bool Drone::move() {
 
   //Delay for each consecutive drone to allow spacing.
   if (currentTimestep - 1 <= id) {
     recordConfiguration();
-    return;
+    return false;
   }
 
   //If no frontiers to explore, then search is complete.
   if (frontierCells.size() == 0) {
     complete = true;
     outputStatistics();
-    return;
+    return false;
   }
 
 
   //If current target has been discovered.
-  if (internalMap[currentTarget.first.x][currentTarget.first.y] != Frontier || hasCommunicated) {
+  if (internalMap(currentTarget.first.x, currentTarget.first.y) != Frontier || hasCommunicated) {
     getNewTarget();
     hasCommunicated = false;
   }
@@ -751,10 +758,14 @@ void Drone::process() {
     setPosition(targetPath.front().x, targetPath.front().y);
     targetPath.erase(targetPath.begin()); //Removes the first cell in the target path.
   }
+  return true;
+}
 
-  pair<vector<SenseCell>,vector<SenseCell>> buffers = sense();
-  updateInternalMap(buffers.first, buffers.second);
-  findFrontierCells(buffers.first, buffers.second);
+//Senses from the drone's new position and records its configuration for the timestep.
+void Drone::observe() {
+  sense();
+  updateInternalMap();
+  findFrontierCells();
   recordConfiguration();
   nearDrones.clear();
 }
@@ -771,7 +782,8 @@ void Drone::getNewTarget() {
     //Target unreachable.
     if (targetPath.size() == 0) {
       frontierCells.erase(currentTarget.first.y * caveWidth + currentTarget.first.x);
-      internalMap[currentTarget.first.x][currentTarget.first.y] = Free;
+      internalMap(currentTarget.first.x, currentTarget.first.y) = Free;
+      senseAll = true; //The dropped frontier is checked again when next in view.
     }
     else {
       newTargetFound = true;
@@ -793,79 +805,80 @@ bool Drone::allowCommunication(int x) {
 }
 
 //Merges the drone's internal map with another drone's map.
-void Drone::combineMaps(vector<vector<int>> referenceMap, map<int,int> referenceFrontierMap, int droneID) {
+void Drone::combineMaps(const CaveGrid &referenceMap, int droneID) {
 
   hasCommunicated = true; //Communication in the current timestep.
+  senseAll = true; //Merged cells may need rechecking when next in view.
 
   vector<Cell> frontierCheck; //List of cells to check if they are frontiers.
   lastCommunication[droneID] = currentTimestep;
 
   //Updates internal map with the given reference map.
-  for (size_t i = 0; i < caveWidth; i++) {
-    for (size_t j = 0; j < caveHeight; j++) {
+  for (int i = 0; i < caveWidth; i++) {
+    for (int j = 0; j < caveHeight; j++) {
 
-      if (referenceMap[i][j] == Unknown) {
+      if (referenceMap(i, j) == Unknown) {
         continue;
       }
-      else if (referenceMap[i][j] == Occupied && internalMap[i][j] == Unknown) {
+      else if (referenceMap(i, j) == Occupied && internalMap(i, j) == Unknown) {
         //Update unknown cell to occupied.
-        internalMap[i][j] = Occupied;
+        internalMap(i, j) = Occupied;
         occupiedCount++;
         commOccupiedCount++;
         //Adds the neighbouring cells to the list to be checked.
-        if (i - 1 >= 0 && internalMap[i-1][j] == Frontier) { frontierCheck.push_back(Cell(i-1,j)); }
-        if (i + 1 < caveWidth && internalMap[i+1][j] == Frontier) { frontierCheck.push_back(Cell(i+1,j)); }
-        if (j - 1 >= 0 && internalMap[i][j-1] == Frontier) { frontierCheck.push_back(Cell(i,j-1)); }
-        if (j + 1 < caveHeight && internalMap[i][j+1] == Frontier) { frontierCheck.push_back(Cell(i,j+1)); }
+        if (i - 1 >= 0 && internalMap(i-1, j) == Frontier) { frontierCheck.push_back(Cell(i-1,j)); }
+        if (i + 1 < caveWidth && internalMap(i+1, j) == Frontier) { frontierCheck.push_back(Cell(i+1,j)); }
+        if (j - 1 >= 0 && internalMap(i, j-1) == Frontier) { frontierCheck.push_back(Cell(i,j-1)); }
+        if (j + 1 < caveHeight && internalMap(i, j+1) == Frontier) { frontierCheck.push_back(Cell(i,j+1)); }
       }
-      else if (referenceMap[i][j] == Free && internalMap[i][j] != Free) {
+      else if (referenceMap(i, j) == Free && internalMap(i, j) != Free) {
         //Update free cell.
-        if (internalMap[i][j] == Unknown) {
+        if (internalMap(i, j) == Unknown) {
           freeCount++;
           commFreeCount++;
         }
-        else if (internalMap[i][j] == Frontier) {
+        else if (internalMap(i, j) == Frontier) {
           frontierCells.erase(j * caveWidth + i); //Removes the frontier from the frontier cell list.
         }
-        internalMap[i][j] = Free;
+        internalMap(i, j) = Free;
         //Adds the neighbouring cells to the list to be checked.
-        if (i - 1 >= 0 && internalMap[i-1][j] == Frontier) { frontierCheck.push_back(Cell(i-1,j)); }
-        if (i + 1 < caveWidth && internalMap[i+1][j] == Frontier) { frontierCheck.push_back(Cell(i+1,j)); }
-        if (j - 1 >= 0 && internalMap[i][j-1] == Frontier) { frontierCheck.push_back(Cell(i,j-1)); }
-        if (j + 1 < caveHeight && internalMap[i][j+1] == Frontier) { frontierCheck.push_back(Cell(i,j+1)); }
+        if (i - 1 >= 0 && internalMap(i-1, j) == Frontier) { frontierCheck.push_back(Cell(i-1,j)); }
+        if (i + 1 < caveWidth && internalMap(i+1, j) == Frontier) { frontierCheck.push_back(Cell(i+1,j)); }
+        if (j - 1 >= 0 && internalMap(i, j-1) == Frontier) { frontierCheck.push_back(Cell(i,j-1)); }
+        if (j + 1 < caveHeight && internalMap(i, j+1) == Frontier) { frontierCheck.push_back(Cell(i,j+1)); }
       }
-      else if (referenceMap[i][j] == Frontier && internalMap[i][j] == Unknown) {
+      else if (referenceMap(i, j) == Frontier && internalMap(i, j) == Unknown) {
         //Update frontier cell.
         freeCount++;
         commFreeCount++;
-        internalMap[i][j] = Free;
+        internalMap(i, j) = Free;
         frontierCheck.push_back(Cell(i,j));
       }
     }
   }
 
   //Checks each cell in the frontier check vector to see if it is a frontier.
+  removeRepeatedCells(frontierCheck);
   for (auto& cell : frontierCheck) {
     int x = cell.x;
     int y = cell.y;
     int i = y * caveWidth + x; //Dictionary key for the cell mapped into 1D.
-    int ts = referenceFrontierMap[i];
 
-    if (x - 1 >= 0 && internalMap[x-1][y] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = 0;
+    if (x - 1 >= 0 && internalMap(x-1, y) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, 0);
     }
-    else if (x + 1 < caveWidth && internalMap[x+1][y] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = 0;
+    else if (x + 1 < caveWidth && internalMap(x+1, y) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, 0);
     }
-    else if (y - 1 >= 0 && internalMap[x][y-1] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = 0;
+    else if (y - 1 >= 0 && internalMap(x, y-1) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, 0);
     }
-    else if (y + 1 < caveHeight && internalMap[x][y+1] == Unknown) {
-      internalMap[x][y] = Frontier;
-      frontierCells[i] = 0;
+    else if (y + 1 < caveHeight && internalMap(x, y+1) == Unknown) {
+      internalMap(x, y) = Frontier;
+      frontierCells.set(i, 0);
     }
   }
 }
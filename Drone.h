@@ -2,6 +2,11 @@
 #include <map>
 #include "DroneConfig.h"
 #include "SenseCell.h"
+#include "CaveGrid.h"
+#include "SenseMethod.h"
+#include "FieldOfView.h"
+#include "VisibilityCache.h"
+#include "FrontierSet.h"
 using namespace std;
 #pragma once
 
@@ -12,23 +17,26 @@ public:
   static float searchRadius;
   static float communicationRadius;
   static int communicationTimeBuffer;
+  static SenseMethod senseMethod;
   string name;
   float posX;
   float posY;
   float bearing;
   bool complete;
-  vector<vector<int>> internalMap;
-  map<int,int> frontierCells;
+  CaveGrid internalMap;
+  FrontierSet frontierCells;
   vector<DroneConfig> pathList;
   pair<Cell,int> currentTarget;
   float totalTravelled;
   //Member Functions.
-  static void setParams(int _caveWidth, int _caveHeight, vector<vector<int>> _cave);
+  static void setParams(const CaveGrid& _cave);
+  static void setVisibility(VisibilityCache& _visibility);
   void init(int _id, float x, float y, string _name);
   void setPosition(float x,  float y);
   void process();
+  static void processAll(vector<Drone> &drones);
   bool allowCommunication(int x);
-  void combineMaps(vector<vector<int>> referenceMap, map<int,int> referenceFrontierMap, int droneID);
+  void combineMaps(const CaveGrid &referenceMap, int droneID);
   vector<string> getStatistics();
   void addNearDrone(float x, float y);
   static float normalDistribution(float x, float mean, float std); //###
@@ -36,7 +44,8 @@ private:
   //Data Members.
   static int caveWidth;
   static int caveHeight;
-  static vector<vector<int>> cave;
+  static CaveGrid cave;
+  static VisibilityCache visibility;
   int id;
   int currentTimestep;
   vector<Cell> targetPath;
@@ -46,12 +55,26 @@ private:
   int commOccupiedCount;
   vector<int> lastCommunication;
   vector<pair<float,float>> nearDrones;
+  FieldOfView fieldOfView;
+  vector<VisibilityRun> visibleRuns; //Cells in view at the previous sense, relative to where it was made.
+  vector<VisibilityRun> senseRuns;
+  int visibleX;
+  int visibleY;
+  bool senseAll; //Whether the next sense returns every cell in view, not just those that can change the internal map.
+  vector<uint8_t> senseScratch;
+  vector<int> senseRowStart; //Index of the first run of each row of senseRuns, offset by the reach.
+  vector<SenseCell> freeCellBuffer; //Free and occupied cells found by the last sense.
+  vector<SenseCell> occupiedCellBuffer;
   //Member functions.
-  pair<vector<SenseCell>,vector<SenseCell>> sense();
+  bool move();
+  void observe();
+  void sense();
   vector<Cell> getPathToTarget(pair<Cell,int> target);
   void recordConfiguration();
-  void updateInternalMap(vector<SenseCell> freeCellBuffer, vector<SenseCell> occupiedCellBuffer);
-  void findFrontierCells(vector<SenseCell> freeCellBuffer, vector<SenseCell> occupiedCellBuffer);
+  void updateInternalMap();
+  void findFrontierCells();
+  static void removeRepeatedCells(vector<Cell> &cells);
+  static double cellUniform(uint64_t draw, int cell);
   vector<pair<float,float>> getNearDroneWeightMap();
   void getFrontierCellStats(float &minTs, float &maxTs, float &minDist, float &maxDist);
   pair<Cell,int> getBestFrontier(vector<pair<float,float>> nearDroneWeightMap);
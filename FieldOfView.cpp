@@ -0,0 +1,236 @@
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+#include "FieldOfView.h"
+#include "MapCell.h"
+using namespace std;
+
+//Distance between a cell and the origin, computed as the drone always has.
+float FieldOfView::distance(int x, int y, float originX, float originY) {
+	return pow(pow(x - originX, 2.0f) + pow(y - originY, 2.0f), 0.5f);
+}
+
+//Division rounding towards negative infinity, for a positive divisor.
+static int floorDiv(int a, int b) {
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+FieldOfView::FieldOfView() : raycastStencilRadius(-1) {}
+
+//Symmetric recursive shadowcasting, scanning each quadrant row by row outwards from the origin.
+//A row spans the columns between a start and end slope, and walls narrow the slopes of the rows
+//behind them. A cell, free or occupied, is sensed only when its centre lies within the row's slopes,
+//which keeps sensing symmetric.
+//Slopes are exact fractions, so no cell is lost or gained to rounding.
+void FieldOfView::shadowcast(const CaveGrid &cave, int originX, int originY, float radius, vector<SenseCell> &freeCells, vector<SenseCell> &occupiedCells) {
+	freeCells.clear();
+	occupiedCells.clear();
+	if (radius < 0 || !(originX >= 0 && originY >= 0 && originX < cave.getWidth() && originY < cave.getHeight())) { return; }
+
+	const int maxDepth = (int)floor(radius);
+	const int side = 2 * maxDepth + 1;
+	sensed.assign((size_t)side * side, 0);
+
+	//Senses a cell of the cave once, if it lies within the radius.
+	auto sense = [&](int x, int y) {
+		uint8_t &done = sensed[(size_t)(y - originY + maxDepth) * side + (x - originX + maxDepth)];
+		if (done) { return; }
+		done = 1;
+		float range = distance(x, y, (float)originX, (float)originY);
+		if (range > radius) { return; }
+		if (cave(x, y) == Free) { freeCells.push_back(SenseCell(x, y, range)); }
+		else { occupiedCells.push_back(SenseCell(x, y, range)); }
+	};
+	sense(originX, originY);
+
+	//Quadrants north, south, east and west, mapping (depth, column) onto the cave.
+	const int depthX[4] = {0, 0, 1, -1};
+	const int depthY[4] = {1, -1, 0, 0};
+	const int columnX[4] = {1, 1, 0, 0};
+	const int columnY[4] = {0, 0, 1, 1};
+
+	for (int q = 0; q < 4; q++) {
+		rows.clear();
+		rows.push_back(Row{1, -1, 1, 1, 1});
+		while (!rows.empty()) {
+			Row row = rows.back();
+			rows.pop_back();
+			if (row.depth > maxDepth) { continue; }
+
+			//Columns whose centres round into the slopes, ties rounding towards the centre column.
+			int minColumn = floorDiv(2 * row.depth * row.startNum + row.startDen, 2 * row.startDen);
+			int maxColumn = -floorDiv(-(2 * row.depth * row.endNum - row.endDen), 2 * row.endDen);
+			int previous = -1; //State of the previous cell in the row: -1 none, 0 free, 1 wall.
+
+			for (int column = minColumn; column <= maxColumn; column++) {
+				int x = originX + row.depth * depthX[q] + column * columnX[q];
+				int y = originY + row.depth * depthY[q] + column * columnY[q];
+				bool inside = x >= 0 && y >= 0 && x < cave.getWidth() && y < cave.getHeight();
+				bool wall = !inside || cave(x, y) != Free;
+				bool symmetric = column * row.startDen >= row.depth * row.startNum && column * row.endDen <= row.depth * row.endNum;
+				if (inside && symmetric) { sense(x, y); }
+
+				//Walls shade the rows behind them: a wall ending narrows the start slope, and a wall
+				//beginning ends the visible span, whose next row is scanned separately.
+				if (previous == 1 && !wall) {
+					row.startNum = 2 * column - 1;
+					row.startDen = 2 * row.depth;
+				}
+				if (previous == 0 && wall) {
+					Row next = row;
+					next.depth++;
+					next.endNum = 2 * column - 1;
+					next.endDen = 2 * row.depth;
+					rows.push_back(next);
+				}
+				previous = wall;
+			}
+			if (previous == 0) {
+				Row next = row;
+				next.depth++;
+				rows.push_back(next);
+			}
+		}
+	}
+}
+
+//Offsets of the cells within the radius of a cell centre, in the order raycasting checks them.
+//Enumerated and sorted over the whole search square just as raycast does for an origin whose square
+//lies inside the cave, so cells of equal range fall in the same order. Shared by every instance, and
+//rebuilt only when the radius changes.
+shared_ptr<const vector<SenseCell>> FieldOfView::stencil(float radius) {
+	static mutex stencilMutex;
+	static shared_ptr<const vector<SenseCell>> offsets;
+	static float offsetsRadius = -1;
+	lock_guard<mutex> lock(stencilMutex);
+	if (!offsets || offsetsRadius != radius) {
+		shared_ptr<vector<SenseCell>> sorted = make_shared<vector<SenseCell>>();
+		for (int i = (int)floor(-radius); i <= (int)ceil(radius); i++) {
+			for (int j = (int)floor(-radius); j <= (int)ceil(radius); j++) {
+				float range = distance(i, j, 0.0f, 0.0f);
+				if (range > radius) { continue; }
+				sorted->push_back(SenseCell(i, j, range));
+			}
+		}
+		sort(sorted->begin(), sorted->end());
+		offsets = sorted;
+		offsetsRadius = radius;
+	}
+	return offsets;
+}
+
+//Original sensing model. Candidate cells are sorted by distance, and each is hidden if the line from
+//the origin to its centre crosses any nearer occupied cell, sensed or not. Kept unchanged, including
+//its test of ty0 for the last edge, so that it senses exactly what drones always have.
+//From a cell centre whose search square lies inside the cave the candidates come from the shared stencil.
+void FieldOfView::raycast(const CaveGrid &cave, float posX, float posY, float searchRadius, vector<SenseCell> &freeCells, vector<SenseCell> &occupiedCells) {
+
+	checkCells.clear();
+	freeCells.clear();
+	occupiedCells.clear();
+
+	const vector<SenseCell>* offsets = nullptr;
+	if (posX == floor(posX) && posY == floor(posY) && floor(posX - searchRadius) >= 0 && floor(posY - searchRadius) >= 0
+		&& ceil(posX + searchRadius) <= cave.getWidth() - 1 && ceil(posY + searchRadius) <= cave.getHeight() - 1) {
+		//Only locks the shared stencil when the radius differs from the one this instance last used.
+		if (!raycastStencil || raycastStencilRadius != searchRadius) {
+			raycastStencil = stencil(searchRadius);
+			raycastStencilRadius = searchRadius;
+		}
+		offsets = raycastStencil.get();
+	}
+	else {
+		candidates.clear();
+		//For each cell in the bounding box of the search range.
+		//Discards Out-of-bounds cells (e.g. i = -1).
+		for (int i = max(0, (int)floor(posX - searchRadius)); i <= min(cave.getWidth() - 1, (int)ceil(posX + searchRadius)); i++) {
+			for (int j = max(0, (int)floor(posY - searchRadius)); j <= min(cave.getHeight() - 1, (int)ceil(posY + searchRadius)); j++) {
+				//Allows only cells in the range.
+				float range = distance(i, j, posX, posY);
+				if (range > searchRadius) { continue; }
+				//Push the candidate cell onto the vector.
+				candidates.push_back(SenseCell(i,j,range));
+			}
+		}
+
+		//Sorts the list of cells by distance to the drone in increasing order.
+		sort(candidates.begin(), candidates.end());
+	}
+	const vector<SenseCell> &ordered = offsets ? *offsets : candidates;
+	float shiftX = offsets ? posX : 0.0f; //Moves stencil offsets onto the origin.
+	float shiftY = offsets ? posY : 0.0f;
+
+	//Check to make sure you can't sense objects hidden behind something else.
+	for (auto const& cell : ordered) {
+		SenseCell dest(cell.x + shiftX, cell.y + shiftY, cell.range);
+		//If the cell range is 1 or less then immediately add it to the list.
+		if (dest.range <= 1) {
+			if (cave(dest.x,dest.y) == Free) {
+				freeCells.push_back(dest);
+			}
+			else {
+				occupiedCells.push_back(dest);
+				checkCells.push_back(dest);
+			}
+			continue;
+		}
+
+		bool collisionDetected = false; //If an occupied cell blocks the path from the drone to the cell to be checked.
+
+		//Obstacle in line of sight between drone position and destination cell check.
+		for (auto const& occupyCheck : checkCells) {
+			//Ignore if the cell to check is free.
+			if (cave(occupyCheck.x,occupyCheck.y) == Free) { continue; }
+
+			float xDiff = dest.x - posX;
+			float yDiff = dest.y - posY;
+			float tx0 = (occupyCheck.x - 0.5f - posX) / xDiff;
+			float tx1 = (occupyCheck.x + 0.5f - posX) / xDiff;
+			float ty0 = (occupyCheck.y - 0.5f - posY) / yDiff;
+			float ty1 = (occupyCheck.y + 0.5f - posY) / yDiff;
+
+			if (tx0 >= 0 && tx0 <= 1) {
+				float yCheck = posY + tx0 * yDiff;
+				if (yCheck >= occupyCheck.y - 0.5f && yCheck <= occupyCheck.y + 0.5f) {
+					collisionDetected = true;
+					break;
+				}
+			}
+			if (tx1 >= 0 && tx1 <= 1) {
+				float yCheck = posY + tx1 * yDiff;
+				if (yCheck >= occupyCheck.y - 0.5f && yCheck <= occupyCheck.y + 0.5f) {
+					collisionDetected = true;
+					break;
+				}
+			}
+			if (ty0 >= 0 && ty0 <= 1) {
+				float xCheck = posX + ty0 * xDiff;
+				if (xCheck >= occupyCheck.x - 0.5f && xCheck <= occupyCheck.x + 0.5f) {
+					collisionDetected = true;
+					break;
+				}
+			}
+			if (ty1 >= 0 && ty0 <= 1) {
+				float xCheck = posX + ty1 * xDiff;
+				if (xCheck >= occupyCheck.x - 0.5f && xCheck <= occupyCheck.x + 0.5f) {
+					collisionDetected = true;
+					break;
+				}
+			}
+		}
+
+		//If no collision detected then the destination cell is in line of sight from the drone's position.
+		if (!collisionDetected) {
+			if (cave(dest.x,dest.y) == Free) {
+				freeCells.push_back(dest);
+			}
+			else {
+				occupiedCells.push_back(dest);
+				checkCells.push_back(dest);
+			}
+		}
+		else {
+			checkCells.push_back(dest);
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "CaveGrid.h"
+#include "SenseCell.h"
+using namespace std;
+
+//Cells a drone can sense from its position: every cell within the search radius that is not hidden
+//behind an occupied cell. Cells outside the cave are never sensed.
+//Shadowcasting is symmetric (a cell sees the drone's cell whenever the drone sees it) and visits each
+//cell in the radius once, where raycasting tests each cell against every nearer occupied cell.
+//Each instance reuses its buffers, so a drone keeps one rather than sharing it between threads.
+class FieldOfView {
+public:
+  FieldOfView();
+  void shadowcast(const CaveGrid &cave, int originX, int originY, float radius, vector<SenseCell> &freeCells, vector<SenseCell> &occupiedCells);
+  void raycast(const CaveGrid &cave, float originX, float originY, float radius, vector<SenseCell> &freeCells, vector<SenseCell> &occupiedCells);
+  static float distance(int x, int y, float originX, float originY);
+private:
+  //Row of cells at one depth from the origin, between two slopes held as fractions.
+  struct Row {
+    int depth;
+    int startNum, startDen;
+    int endNum, endDen;
+  };
+  vector<Row> rows; //Rows waiting to be scanned.
+  vector<uint8_t> sensed; //Cells of the search square already sensed, as cells on the diagonals are scanned twice.
+  vector<SenseCell> candidates; //Cells in the radius ordered by range, when raycasting cannot use the stencil.
+  vector<SenseCell> checkCells; //Nearer cells that raycasting tests as obstacles.
+  shared_ptr<const vector<SenseCell>> raycastStencil; //Shared stencil last used, fetched again only when the radius changes.
+  float raycastStencilRadius;
+  static shared_ptr<const vector<SenseCell>> stencil(float radius);
+};
@@ -0,0 +1,241 @@
+#ifndef FRONTIERSET_H
+#define FRONTIERSET_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <climits>
+#include <limits>
+using namespace std;
+
+//Frontier cells of a drone's map with the timestep each was last identified in, keyed by the cell's
+//index y * width + x. Cells are held densely in x, y and timestep columns, and each square bucket of
+//the cave lists the positions of its cells in the columns along with the latest timestep among them.
+//A cell is found by scanning its bucket, so memory grows with the number of frontiers rather than
+//the size of the cave, and queries by area, radius or nearest cells only visit the buckets around the point.
+//The number of cells at each timestep is counted, keeping the latest timestep at hand.
+//Removing a cell moves the last one into its place, so the columns are in no particular order.
+//Timesteps must not be negative.
+class FrontierSet {
+public:
+  static const int bucketShift = 4; //Buckets span 16 by 16 cells.
+  static const int bucketSize = 1 << bucketShift;
+  FrontierSet() : width(0), latest(INT_MIN), bucketsWide(0), bucketsHigh(0) {}
+
+  //Sizes the set for a cave, removing every cell.
+  void resize(int _width, int _height) {
+    width = _width;
+    xs.clear();
+    ys.clear();
+    timesteps.clear();
+    slots.clear();
+    timestepCounts.clear();
+    latest = INT_MIN;
+    bucketsWide = (_width + bucketSize - 1) >> bucketShift;
+    bucketsHigh = (_height + bucketSize - 1) >> bucketShift;
+    buckets.assign((size_t)bucketsWide * bucketsHigh, vector<int>());
+    bucketLatest.assign(buckets.size(), INT_MIN);
+  }
+
+  size_t size() const { return xs.size(); }
+  int getX(size_t k) const { return xs[k]; }
+  int getY(size_t k) const { return ys[k]; }
+  int getTimestep(size_t k) const { return timesteps[k]; }
+  bool contains(int cell) const { return find(cell) >= 0; }
+  int getTimestepOf(int cell) const { return timesteps[find(cell)]; }
+
+  //Adds a cell with the given timestep, or updates the timestep of a cell already in the set.
+  void set(int cell, int timestep) {
+    int position = find(cell);
+    size_t b = bucketOf(cell % width, cell / width);
+    if (position >= 0) {
+      int previous = timesteps[position];
+      timesteps[position] = timestep;
+      if (timestep >= bucketLatest[b]) { bucketLatest[b] = timestep; }
+      else if (previous == bucketLatest[b]) { updateLatest(b); }
+      count(timestep);
+      uncount(previous);
+      return;
+    }
+    count(timestep);
+    xs.push_back(cell % width);
+    ys.push_back(cell / width);
+    timesteps.push_back(timestep);
+    slots.push_back(buckets[b].size());
+    buckets[b].push_back(xs.size() - 1);
+    bucketLatest[b] = max(bucketLatest[b], timestep);
+  }
+
+  //Removes a cell if it is in the set.
+  void erase(int cell) {
+    int position = find(cell);
+    if (position < 0) { return; }
+    size_t b = bucketOf(xs[position], ys[position]);
+    int timestep = timesteps[position];
+    vector<int> &bucket = buckets[b];
+    bucket[slots[position]] = bucket.back();
+    slots[bucket.back()] = slots[position];
+    bucket.pop_back();
+
+    //Moves the last cell into the freed position, repointing its bucket's entry.
+    size_t last = xs.size() - 1;
+    if ((size_t)position != last) {
+      xs[position] = xs[last];
+      ys[position] = ys[last];
+      timesteps[position] = timesteps[last];
+      slots[position] = slots[last];
+      buckets[bucketOf(xs[position], ys[position])][slots[position]] = position;
+    }
+    xs.pop_back();
+    ys.pop_back();
+    timesteps.pop_back();
+    slots.pop_back();
+    if (timestep == bucketLatest[b]) { updateLatest(b); }
+    uncount(timestep);
+  }
+
+  //Latest timestep of any cell in the set, INT_MIN if it is empty.
+  int getLatestTimestep() const { return latest; }
+
+  //Calls visit(x, y) for each cell in the set within the box from (x0, y0) to (x1, y1) inclusive.
+  template <class Visit>
+  void forEachInBox(int x0, int y0, int x1, int y1, Visit visit) const {
+    x0 = max(x0, 0);
+    y0 = max(y0, 0);
+    x1 = min(x1, bucketsWide * bucketSize - 1);
+    y1 = min(y1, bucketsHigh * bucketSize - 1);
+    for (int by = y0 >> bucketShift; by <= y1 >> bucketShift; by++) {
+      for (int bx = x0 >> bucketShift; bx <= x1 >> bucketShift; bx++) {
+        for (int k : buckets[(size_t)by * bucketsWide + bx]) {
+          int x = xs[k];
+          int y = ys[k];
+          if (x >= x0 && x <= x1 && y >= y0 && y <= y1) { visit(x, y); }
+        }
+      }
+    }
+  }
+
+  //Calls visit(x, y) for each cell in the set whose centre lies within the radius of the point (x, y).
+  template <class Visit>
+  void forEachInRadius(float x, float y, float radius, Visit visit) const {
+    const float radiusSq = radius * radius;
+    forEachInBox((int)floor(x - radius), (int)floor(y - radius), (int)ceil(x + radius), (int)ceil(y + radius), [&](int cx, int cy) {
+      if ((cx - x) * (cx - x) + (cy - y) * (cy - y) <= radiusSq) { visit(cx, cy); }
+    });
+  }
+
+  //Index of the cell nearest to the point (x, y) in the cave among those with at least the given
+  //timestep, or -1 if there is none. Of equally near cells the lowest index wins, as in a scan in cell
+  //order keeping the first nearest. distance(cellX, cellY) must give the Euclidean distance from the
+  //point to within a rounding error.
+  template <class Distance>
+  int nearest(float x, float y, int minTimestep, Distance distance) const {
+    int best = -1;
+    float bestDistance = numeric_limits<float>::max();
+    searchRings(x, y, minTimestep, [&](size_t k) {
+      int cell = key(k);
+      float d = distance(xs[k], ys[k]);
+      if (d < bestDistance || (d == bestDistance && cell < best)) {
+        best = cell;
+        bestDistance = d;
+      }
+    }, [&](float reach) { return best >= 0 && bestDistance < reach; });
+    return best;
+  }
+
+  //Indexes of up to k cells nearest to the point (x, y) among those with at least the given timestep,
+  //nearest first with equally near cells in index order. distance is as for nearest.
+  template <class Distance>
+  vector<int> nearestK(float x, float y, size_t k, int minTimestep, Distance distance) const {
+    vector<pair<float,int>> found; //Distance and index of the nearest cells so far, in order.
+    if (k == 0) { return vector<int>(); }
+    searchRings(x, y, minTimestep, [&](size_t p) {
+      pair<float,int> candidate(distance(xs[p], ys[p]), key(p));
+      if (found.size() == k && !(candidate < found.back())) { return; }
+      found.insert(upper_bound(found.begin(), found.end(), candidate), candidate);
+      if (found.size() > k) { found.pop_back(); }
+    }, [&](float reach) { return found.size() == k && found.back().first < reach; });
+    vector<int> cells(found.size());
+    for (size_t i = 0; i < found.size(); i++) {
+      cells[i] = found[i].second;
+    }
+    return cells;
+  }
+
+private:
+  int key(size_t k) const { return ys[k] * width + xs[k]; }
+  size_t bucketOf(int x, int y) const { return (size_t)(y >> bucketShift) * bucketsWide + (x >> bucketShift); }
+
+  //Position of a cell in the columns, -1 if it is not in the set.
+  int find(int cell) const {
+    int x = cell % width;
+    int y = cell / width;
+    for (int k : buckets[bucketOf(x, y)]) {
+      if (xs[k] == x && ys[k] == y) { return k; }
+    }
+    return -1;
+  }
+
+  //Calls visit(k) for the cells with at least the given timestep in rings of buckets searched outwards
+  //from the point's bucket, until done(reach) is true for the distance reach from the point within which
+  //every cell has been visited.
+  template <class Visit, class Done>
+  void searchRings(float x, float y, int minTimestep, Visit visit, Done done) const {
+    int centreX = min(max((int)floor(x) >> bucketShift, 0), bucketsWide - 1);
+    int centreY = min(max((int)floor(y) >> bucketShift, 0), bucketsHigh - 1);
+    for (int ring = 0; ring < max(bucketsWide, bucketsHigh); ring++) {
+      //Cells of this ring lie more than ring - 1 buckets from the point along one axis.
+      if (done((ring - 1) * bucketSize - 0.01f)) { return; }
+      for (int by = max(centreY - ring, 0); by <= min(centreY + ring, bucketsHigh - 1); by++) {
+        bool edge = (by == centreY - ring || by == centreY + ring);
+        int step = (edge || ring == 0) ? 1 : 2 * ring; //Only the ends of the rows between the edges.
+        for (int bx = centreX - ring; bx <= centreX + ring; bx += step) {
+          if (bx < 0 || bx >= bucketsWide) { continue; }
+          size_t b = (size_t)by * bucketsWide + bx;
+          if (bucketLatest[b] < minTimestep) { continue; }
+          for (int k : buckets[b]) {
+            if (timesteps[k] >= minTimestep) { visit(k); }
+          }
+        }
+      }
+    }
+  }
+
+  //Counts a cell at a timestep.
+  void count(int timestep) {
+    if ((size_t)timestep >= timestepCounts.size()) { timestepCounts.resize(timestep + 1, 0); }
+    timestepCounts[timestep]++;
+    latest = max(latest, timestep);
+  }
+
+  //Uncounts a cell at a timestep, stepping the latest timestep back past any left with no cells.
+  void uncount(int timestep) {
+    timestepCounts[timestep]--;
+    while (latest >= 0 && timestepCounts[latest] == 0) { latest--; }
+    if (latest < 0) { latest = INT_MIN; }
+  }
+
+  //Rescans a bucket for its latest timestep after the cell holding it left or moved earlier.
+  void updateLatest(size_t b) {
+    bucketLatest[b] = INT_MIN;
+    for (int k : buckets[b]) {
+      bucketLatest[b] = max(bucketLatest[b], timesteps[k]);
+    }
+  }
+
+  int width;
+  vector<int> xs;
+  vector<int> ys;
+  vector<int> timesteps;
+  vector<int> slots; //Position of each cell in its bucket's list.
+  vector<int> timestepCounts; //Number of cells at each timestep.
+  int latest; //Latest timestep with any cells, INT_MIN if there are none.
+  int bucketsWide;
+  int bucketsHigh;
+  vector<vector<int>> buckets; //Positions in the columns of the cells in each bucket, row by row.
+  vector<int> bucketLatest; //Latest timestep in each bucket, INT_MIN if it is empty.
+};
+
+#endif
@@ -1 +1,2 @@
+#pragma once
 enum MapCell { Free, Occupied, Unknown, Frontier };
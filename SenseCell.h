@@ -8,4 +8,9 @@ struct SenseCell {
   SenseCell(float _x, float _y, float _range) : x(_x), y(_y), range(_range) {}
 };
 
+//Less than comparison function for two SenseCell objects.
+inline bool operator <(const SenseCell& a, const SenseCell& b) {
+  return a.range < b.range;
+}
+
 #endif
@@ -0,0 +1,2 @@
+#pragma once
+enum SenseMethod { Raycast, Shadowcast };
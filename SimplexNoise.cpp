@@ -27,6 +27,15 @@
 #include "SimplexNoise.h"
 
 #include <cstdint>  // int32_t/uint8_t
+#include <cstring>  // memcpy
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMPLEX_X86_SIMD
+typedef float   f32x4 __attribute__((vector_size(16)));   ///< SSE2 register of 4 floats
+typedef int32_t i32x4 __attribute__((vector_size(16)));   ///< SSE2 register of 4 integers
+typedef float   f32x8 __attribute__((vector_size(32)));   ///< AVX2 register of 8 floats
+typedef int32_t i32x8 __attribute__((vector_size(32)));   ///< AVX2 register of 8 integers
+#endif
 
 /**
  * Computes the largest integer value not greater than the float one
@@ -291,15 +300,358 @@ float SimplexNoise::noise(float x, float y) {
 
 
 /**
- * 3D Perlin simplex noise
+ * Gradient (x, y) of a hashed value, such that grad(hash, x, y) == gx * x + gy * y
+ *
+ *  The low 2 bits give the signs, and values with (hash & 0x3F) < 4 weight x less than y.
+ */
+static inline void gradient2D(uint8_t hash, int8_t g[2]) {
+    const int32_t h = hash & 0x3F;
+    const int8_t unit   = (h & 1) ? -1 : 1;
+    const int8_t double2 = (h & 2) ? -2 : 2;
+    g[0] = (h < 4) ? unit : double2;
+    g[1] = (h < 4) ? double2 : unit;
+}
+
+/**
+ * Fills the repeated permutation table, and the gradient table indexed like it, from a permutation of 0-255
+ */
+static void buildTables(SimplexNoise::Tables& tables, const uint8_t* permutation) {
+    for (int32_t k = 0; k < 512; k++) {
+        tables.perm[k] = permutation[k & 0xFF];
+        gradient2D(tables.perm[k], tables.grad[k]);
+    }
+}
+
+/**
+ * Tables built from the classic permutation used by the static noise functions
+ */
+const SimplexNoise::Tables& SimplexNoise::classicTables() {
+    static const Tables tables = []() {
+        Tables t;
+        buildTables(t, perm);
+        return t;
+    }();
+    return tables;
+}
+
+/**
+ * Constructor of a seeded fractal noise summation, with its own permutation and gradient tables
+ *
+ *  The permutation is a Fisher-Yates shuffle of 0-255 driven by a SplitMix64 generator.
+ */
+SimplexNoise::SimplexNoise(float frequency, float amplitude, float lacunarity, float persistence, uint64_t seed) :
+    mFrequency(frequency),
+    mAmplitude(amplitude),
+    mLacunarity(lacunarity),
+    mPersistence(persistence) {
+    uint8_t permutation[256];
+    for (int32_t k = 0; k < 256; k++) {
+        permutation[k] = static_cast<uint8_t>(k);
+    }
+    uint64_t state = seed;
+    for (int32_t k = 255; k > 0; k--) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= (z >> 31);
+        const int32_t other = static_cast<int32_t>(z % static_cast<uint64_t>(k + 1));
+        const uint8_t swap = permutation[k];
+        permutation[k] = permutation[other];
+        permutation[other] = swap;
+    }
+    buildTables(mTables, permutation);
+}
+
+/**
+ * 2D Perlin simplex noise using the permutation and gradient tables of this instance
+ *
+ *  Performs the same float operations as noise(x, y), so an instance built with the classic
+ *  permutation (any instance constructed without a seed) returns bit-identical values.
  *
  * @param[in] x float coordinate
  * @param[in] y float coordinate
- * @param[in] z float coordinate
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y, float z) {
+float SimplexNoise::sample(float x, float y) const {
+    float n0, n1, n2;   // Noise contributions from the three corners
+
+    static const float F2 = 0.366025403f;  // F2 = (sqrt(3) - 1) / 2
+    static const float G2 = 0.211324865f;  // G2 = (3 - sqrt(3)) / 6   = F2 / (1 + 2 * K)
+
+    // Skew the input space to determine which simplex cell we're in
+    const float s = (x + y) * F2;
+    const float xs = x + s;
+    const float ys = y + s;
+    const int32_t i = fastfloor(xs);
+    const int32_t j = fastfloor(ys);
+
+    // Unskew the cell origin back to (x,y) space
+    const float t = static_cast<float>(i + j) * G2;
+    const float X0 = i - t;
+    const float Y0 = j - t;
+    const float x0 = x - X0;
+    const float y0 = y - Y0;
+
+    // Offsets for the middle corner: (1,0) in the lower triangle, (0,1) in the upper one
+    const int32_t i1 = (x0 > y0) ? 1 : 0;
+    const int32_t j1 = 1 - i1;
+
+    const float x1 = x0 - i1 + G2;
+    const float y1 = y0 - j1 + G2;
+    const float x2 = x0 - 1.0f + 2.0f * G2;
+    const float y2 = y0 - 1.0f + 2.0f * G2;
+
+    // Gradients of the three simplex corners, read straight from the repeated tables
+    const int32_t ii = i & 0xFF;
+    const int32_t jj = j & 0xFF;
+    const int8_t* g0 = mTables.grad[ii + mTables.perm[jj]];
+    const int8_t* g1 = mTables.grad[ii + i1 + mTables.perm[jj + j1]];
+    const int8_t* g2 = mTables.grad[ii + 1 + mTables.perm[jj + 1]];
+
+    float t0 = 0.5f - x0*x0 - y0*y0;
+    if (t0 < 0.0f) {
+        n0 = 0.0f;
+    } else {
+        t0 *= t0;
+        n0 = t0 * t0 * (g0[0] * x0 + g0[1] * y0);
+    }
+
+    float t1 = 0.5f - x1*x1 - y1*y1;
+    if (t1 < 0.0f) {
+        n1 = 0.0f;
+    } else {
+        t1 *= t1;
+        n1 = t1 * t1 * (g1[0] * x1 + g1[1] * y1);
+    }
+
+    float t2 = 0.5f - x2*x2 - y2*y2;
+    if (t2 < 0.0f) {
+        n2 = 0.0f;
+    } else {
+        t2 *= t2;
+        n2 = t2 * t2 * (g2[0] * x2 + g2[1] * y2);
+    }
+
+    return 45.23065f * (n0 + n1 + n2);
+}
+
+#ifdef SIMPLEX_X86_SIMD
+/**
+ * Lane-wise gradients of the corners at the given indices of the repeated tables
+ *
+ * @param[out] gx     x component of each gradient
+ * @param[out] gy     y component of each gradient
+ * @param[in]  tables permutation and gradient tables
+ * @param[in]  ii     cell x coordinates, including the corner offset, in the range [0; 256]
+ * @param[in]  jj     cell y coordinates, including the corner offset, in the range [0; 256]
+ */
+template <typename F, typename I, int N>
+static inline __attribute__((always_inline)) void gradientLanes(F& gx, F& gy, const SimplexNoise::Tables& tables,
+                                                                 const I& ii, const I& jj) {
+    for (int k = 0; k < N; k++) {
+        const int8_t* g = tables.grad[ii[k] + tables.perm[jj[k]]];
+        gx[k] = g[0];
+        gy[k] = g[1];
+    }
+}
+
+/**
+ * N samples of 2D Perlin simplex noise at once.
+ *
+ * Every lane performs exactly the same float operations, in the same order, as sample(x, y)
+ * so the results are bit-identical to the scalar version.
+ *
+ * @param[out] result N noise values
+ * @param[in]  tables permutation and gradient tables
+ * @param[in]  x      N x coordinates
+ * @param[in]  yv     N y coordinates
+ */
+template <typename F, typename I, int N>
+static inline __attribute__((always_inline)) void noiseLanes(F& result, const SimplexNoise::Tables& tables,
+                                                              const F& x, const F& yv) {
+    static const float F2 = 0.366025403f;
+    static const float G2 = 0.211324865f;
+    const F zero = {};
+
+    // Skew the input space to determine which simplex cell we're in
+    const F s = (x + yv) * F2;
+    const F xs0 = x + s;
+    const F ys0 = yv + s;
+    I i = __builtin_convertvector(xs0, I);
+    I j = __builtin_convertvector(ys0, I);
+    i += (xs0 < __builtin_convertvector(i, F));   // fastfloor: comparison masks are -1 when true
+    j += (ys0 < __builtin_convertvector(j, F));
+
+    // Unskew the cell origin back to (x,y) space
+    const F t = __builtin_convertvector(i + j, F) * G2;
+    const F x0 = x - (__builtin_convertvector(i, F) - t);
+    const F y0 = yv - (__builtin_convertvector(j, F) - t);
+
+    // Offsets for the middle corner: (1,0) in the lower triangle, (0,1) in the upper one
+    const I i1 = -(x0 > y0);
+    const I j1 = 1 - i1;
+    const F x1 = x0 - __builtin_convertvector(i1, F) + G2;
+    const F y1 = y0 - __builtin_convertvector(j1, F) + G2;
+    const F x2 = x0 - 1.0f + 2.0f * G2;
+    const F y2 = y0 - 1.0f + 2.0f * G2;
+
+    // Gradients of the three simplex corners
+    const I ii = i & 0xFF;
+    const I jj = j & 0xFF;
+    F gx0, gy0, gx1, gy1, gx2, gy2;
+    gradientLanes<F, I, N>(gx0, gy0, tables, ii, jj);
+    gradientLanes<F, I, N>(gx1, gy1, tables, ii + i1, jj + j1);
+    gradientLanes<F, I, N>(gx2, gy2, tables, ii + 1, jj + 1);
+
+    // Contributions from the three corners, zero outside of each corner's radius
+    const F t0 = 0.5f - x0*x0 - y0*y0;
+    const F tt0 = t0 * t0;
+    const F n0 = (t0 < 0.0f) ? zero : tt0 * tt0 * (gx0 * x0 + gy0 * y0);
+    const F t1 = 0.5f - x1*x1 - y1*y1;
+    const F tt1 = t1 * t1;
+    const F n1 = (t1 < 0.0f) ? zero : tt1 * tt1 * (gx1 * x1 + gy1 * y1);
+    const F t2 = 0.5f - x2*x2 - y2*y2;
+    const F tt2 = t2 * t2;
+    const F n2 = (t2 < 0.0f) ? zero : tt2 * tt2 * (gx2 * x2 + gy2 * y2);
+
+    result = 45.23065f * (n0 + n1 + n2);
+}
+
+/**
+ * N samples of fBm summed 2D Perlin simplex noise at once, keeping every octave in registers.
+ *
+ * Octaves are accumulated in the same order as fractal(octaves, x, y) so the results are bit-identical.
+ */
+template <typename F, typename I, int N>
+static inline __attribute__((always_inline)) void fractalLanes(F& result, const SimplexNoise::Tables& tables,
+                                                                const F& x, const F& yv, size_t octaves,
+                                                                float frequency, float amplitude,
+                                                                float lacunarity, float persistence) {
+    F output = {};
+    float denom = 0.f;
+
+    for (size_t i = 0; i < octaves; i++) {
+        F octave;
+        noiseLanes<F, I, N>(octave, tables, x * frequency, yv * frequency);
+        output += (amplitude * octave);
+        denom += amplitude;
+
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+
+    result = output / denom;
+}
+
+/**
+ * Batch fBm noise using N-wide registers, returning the number of samples processed.
+ * The plain noise values are computed instead when the fBm parameters are ignored (octaves of 0).
+ */
+template <typename F, typename I, int N>
+static inline __attribute__((always_inline)) size_t fractalRowLanes(float* out, const SimplexNoise::Tables& tables,
+                                                                     const float* xs, float y, size_t n, size_t octaves,
+                                                                     float frequency, float amplitude,
+                                                                     float lacunarity, float persistence) {
+    const F yv = F{} + y;
+    size_t k = 0;
+    for (; k + N <= n; k += N) {
+        F x, result;
+        memcpy(&x, xs + k, sizeof(x));
+        if (octaves == 0) {
+            noiseLanes<F, I, N>(result, tables, x, yv);
+        } else {
+            fractalLanes<F, I, N>(result, tables, x, yv, octaves, frequency, amplitude, lacunarity, persistence);
+        }
+        memcpy(out + k, &result, sizeof(result));
+    }
+    return k;
+}
+
+/**
+ * Batch fBm noise using 8-wide AVX2 registers, returning the number of samples processed
+ */
+__attribute__((target("avx2")))
+static size_t fractalRowAVX2(float* out, const SimplexNoise::Tables& tables, const float* xs, float y, size_t n,
+                             size_t octaves, float frequency, float amplitude, float lacunarity, float persistence) {
+    return fractalRowLanes<f32x8, i32x8, 8>(out, tables, xs, y, n, octaves, frequency, amplitude, lacunarity, persistence);
+}
+
+/**
+ * Batch fBm noise using 4-wide SSE2 registers, returning the number of samples processed
+ */
+static size_t fractalRowSSE2(float* out, const SimplexNoise::Tables& tables, const float* xs, float y, size_t n,
+                             size_t octaves, float frequency, float amplitude, float lacunarity, float persistence) {
+    return fractalRowLanes<f32x4, i32x4, 4>(out, tables, xs, y, n, octaves, frequency, amplitude, lacunarity, persistence);
+}
+
+/**
+ * Batch fBm noise using the widest registers the CPU supports, returning the number of samples processed
+ */
+static size_t fractalRowSIMD(float* out, const SimplexNoise::Tables& tables, const float* xs, float y, size_t n,
+                             size_t octaves, float frequency, float amplitude, float lacunarity, float persistence) {
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    size_t k = 0;
+    if (hasAVX2) {
+        k = fractalRowAVX2(out, tables, xs, y, n, octaves, frequency, amplitude, lacunarity, persistence);
+    }
+    return k + fractalRowSSE2(out + k, tables, xs + k, y, n - k, octaves, frequency, amplitude, lacunarity, persistence);
+}
+#endif
+
+/**
+ * Batch 2D Perlin simplex noise of a row of samples sharing the same y coordinate
+ *
+ *  Uses AVX2 (8 samples at once) when the CPU supports it, otherwise SSE2 (4 samples at once),
+ *  with the scalar noise(x, y) used for the remaining samples and on other architectures.
+ *  Results are bit-identical to calling noise(xs[k], y) for each sample.
+ *
+ * @param[out] out  n noise values in the range[-1; 1]
+ * @param[in]  xs   n x coordinates
+ * @param[in]  y    y coordinate shared by all the samples
+ * @param[in]  n    number of samples
+ */
+void SimplexNoise::noiseRow(float* out, const float* xs, float y, size_t n) {
+    size_t k = 0;
+#ifdef SIMPLEX_X86_SIMD
+    k = fractalRowSIMD(out, classicTables(), xs, y, n, 0, 1.0f, 1.0f, 1.0f, 1.0f);
+#endif
+    for (; k < n; k++) {
+        out[k] = noise(xs[k], y);
+    }
+}
+
+/**
+ * Batch 2D noise of this instance for a row of samples sharing the same y coordinate
+ *
+ *  Results are bit-identical to calling sample(xs[k], y) for each sample.
+ *
+ * @param[out] out  n noise values in the range[-1; 1]
+ * @param[in]  xs   n x coordinates
+ * @param[in]  y    y coordinate shared by all the samples
+ * @param[in]  n    number of samples
+ */
+void SimplexNoise::sampleRow(float* out, const float* xs, float y, size_t n) const {
+    size_t k = 0;
+#ifdef SIMPLEX_X86_SIMD
+    k = fractalRowSIMD(out, mTables, xs, y, n, 0, 1.0f, 1.0f, 1.0f, 1.0f);
+#endif
+    for (; k < n; k++) {
+        out[k] = sample(xs[k], y);
+    }
+}
+
+/**
+ * 3D Perlin simplex noise hashing corners through the given permutation table
+ *
+ * @param[in] permutation   permutation of 0-255 indexed by the low 8 bits of a value
+ * @param[in] x             float coordinate
+ * @param[in] y             float coordinate
+ * @param[in] z             float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+static float noise3D(const uint8_t* permutation, float x, float y, float z) {
     float n0, n1, n2, n3; // Noise contributions from the four corners
 
     // Skewing/Unskewing factors for 3D
@@ -356,10 +708,11 @@ float SimplexNoise::noise(float x, float y, float z) {
     float z3 = z0 - 1.0f + 3.0f * G3;
 
     // Work out the hashed gradient indices of the four simplex corners
-    int gi0 = hash(i + hash(j + hash(k)));
-    int gi1 = hash(i + i1 + hash(j + j1 + hash(k + k1)));
-    int gi2 = hash(i + i2 + hash(j + j2 + hash(k + k2)));
-    int gi3 = hash(i + 1 + hash(j + 1 + hash(k + 1)));
+    auto hash3 = [permutation](int32_t v) { return permutation[static_cast<uint8_t>(v)]; };
+    int gi0 = hash3(i + hash3(j + hash3(k)));
+    int gi1 = hash3(i + i1 + hash3(j + j1 + hash3(k + k1)));
+    int gi2 = hash3(i + i2 + hash3(j + j2 + hash3(k + k2)));
+    int gi3 = hash3(i + 1 + hash3(j + 1 + hash3(k + 1)));
 
     // Calculate the contribution from the four corners
     float t0 = 0.6f - x0*x0 - y0*y0 - z0*z0;
@@ -395,6 +748,34 @@ float SimplexNoise::noise(float x, float y, float z) {
     return 32.0f*(n0 + n1 + n2 + n3);
 }
 
+/**
+ * 3D Perlin simplex noise
+ *
+ * @param[in] x float coordinate
+ * @param[in] y float coordinate
+ * @param[in] z float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::noise(float x, float y, float z) {
+    return noise3D(perm, x, y, z);
+}
+
+/**
+ * 3D Perlin simplex noise using the permutation table of this instance
+ *
+ *  An instance built with the classic permutation returns the same values as noise(x, y, z).
+ *
+ * @param[in] x float coordinate
+ * @param[in] y float coordinate
+ * @param[in] z float coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::sample(float x, float y, float z) const {
+    return noise3D(mTables.perm, x, y, z);
+}
+
 
 /**
  * Fractal/Fractional Brownian Motion (fBm) summation of 1D Perlin Simplex noise
@@ -437,7 +818,7 @@ float SimplexNoise::fractal(size_t octaves, float x, float y) const {
     float amplitude = mAmplitude;
 
     for (size_t i = 0; i < octaves; i++) {
-        output += (amplitude * noise(x * frequency, y * frequency));
+        output += (amplitude * sample(x * frequency, y * frequency));
         denom += amplitude;
 
         frequency *= mLacunarity;
@@ -447,6 +828,32 @@ float SimplexNoise::fractal(size_t octaves, float x, float y) const {
     return (output / denom);
 }
 
+/**
+ * Batch Fractal/Fractional Brownian Motion (fBm) summation of 2D Perlin Simplex noise
+ * for a row of samples sharing the same y coordinate
+ *
+ *  All the octaves of a group of 8 (AVX2) or 4 (SSE2) samples are summed in one pass,
+ *  with fractal(octaves, x, y) used for the remaining samples and on other architectures.
+ *  Results are bit-identical to calling fractal(octaves, xs[k], y) for each sample.
+ *
+ * @param[in]  octaves  number of fraction of noise to sum
+ * @param[out] out      n noise values in the range[-1; 1]
+ * @param[in]  xs       n x coordinates
+ * @param[in]  y        y coordinate shared by all the samples
+ * @param[in]  n        number of samples
+ */
+void SimplexNoise::fractalRow(size_t octaves, float* out, const float* xs, float y, size_t n) const {
+    size_t k = 0;
+#ifdef SIMPLEX_X86_SIMD
+    if (octaves > 0) {
+        k = fractalRowSIMD(out, mTables, xs, y, n, octaves, mFrequency, mAmplitude, mLacunarity, mPersistence);
+    }
+#endif
+    for (; k < n; k++) {
+        out[k] = fractal(octaves, xs[k], y);
+    }
+}
+
 /**
  * Fractal/Fractional Brownian Motion (fBm) summation of 3D Perlin Simplex noise
  *
@@ -464,7 +871,7 @@ float SimplexNoise::fractal(size_t octaves, float x, float y, float z) const {
     float amplitude = mAmplitude;
 
     for (size_t i = 0; i < octaves; i++) {
-        output += (amplitude * noise(x * frequency, y * frequency, z * frequency));
+        output += (amplitude * sample(x * frequency, y * frequency, z * frequency));
         denom += amplitude;
 
         frequency *= mLacunarity;
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstddef>  // size_t
+#include <cstdint>  // uint8_t/int8_t/uint64_t
 
 /**
  * @brief A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
@@ -23,11 +24,34 @@ public:
     // 3D Perlin simplex noise
     static float noise(float x, float y, float z);
 
+    // Batch 2D Perlin simplex noise of a row of samples sharing the same y coordinate
+    static void noiseRow(float* out, const float* xs, float y, size_t n);
+
     // Fractal/Fractional Brownian Motion (fBm) noise summation
     float fractal(size_t octaves, float x) const;
     float fractal(size_t octaves, float x, float y) const;
     float fractal(size_t octaves, float x, float y, float z) const;
 
+    // Batch fBm summation of 2D noise for a row of samples sharing the same y coordinate
+    void fractalRow(size_t octaves, float* out, const float* xs, float y, size_t n) const;
+
+    // 2D Perlin simplex noise using the permutation and gradient tables of this instance
+    float sample(float x, float y) const;
+    // Batch 2D noise of this instance for a row of samples sharing the same y coordinate
+    void sampleRow(float* out, const float* xs, float y, size_t n) const;
+    // 3D Perlin simplex noise using the permutation table of this instance
+    float sample(float x, float y, float z) const;
+
+    /**
+     * Lookup tables of a noise instance, stored together so the whole set spans a few cache lines
+     *
+     * Both tables are repeated twice so that a corner lookup perm[i + perm[j]] never needs wrapping.
+     */
+    struct Tables {
+        uint8_t perm[512];      ///< Permutation of 0-255, repeated twice
+        int8_t  grad[512][2];   ///< 2D gradient (x, y) of the hashed value perm[k], indexed like perm
+    };
+
     /**
      * Constructor of to initialize a fractal noise summation
      *
@@ -43,13 +67,32 @@ public:
         mFrequency(frequency),
         mAmplitude(amplitude),
         mLacunarity(lacunarity),
-        mPersistence(persistence) {
+        mPersistence(persistence),
+        mTables(classicTables()) {
     }
 
+    /**
+     * Constructor of a seeded fractal noise summation, with its own permutation and gradient tables
+     *
+     *  Different seeds give unrelated noise fields around the same coordinates,
+     *  so callers can sample near the origin where float precision is best.
+     *
+     * @param[in] frequency    Frequency ("width") of the first octave of noise
+     * @param[in] amplitude    Amplitude ("height") of the first octave of noise
+     * @param[in] lacunarity   Lacunarity specifies the frequency multiplier between successive octaves
+     * @param[in] persistence  Persistence is the loss of amplitude between successive octaves
+     * @param[in] seed         64-bit seed shuffling the permutation table
+     */
+    SimplexNoise(float frequency, float amplitude, float lacunarity, float persistence, uint64_t seed);
+
 private:
+    // Tables built from the classic permutation used by the static noise functions
+    static const Tables& classicTables();
+
     // Parameters of Fractional Brownian Motion (fBm) : sum of N "octaves" of noise
     float mFrequency;   ///< Frequency ("width") of the first octave of noise (default to 1.0)
     float mAmplitude;   ///< Amplitude ("height") of the first octave of noise (default to 1.0)
     float mLacunarity;  ///< Lacunarity specifies the frequency multiplier between successive octaves (default to 2.0).
     float mPersistence; ///< Persistence is the loss of amplitude between successive octaves (usually 1/lacunarity)
+    Tables mTables;     ///< Permutation and gradient tables of this instance
 };
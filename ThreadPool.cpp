@@ -0,0 +1,96 @@
+#include <algorithm>
+#include "ThreadPool.h"
+using namespace std;
+
+int ThreadPool::sharedThreads = 0; //Total threads of the shared pool, 0 uses every hardware thread.
+
+//Starts the workers. The calling thread counts as one of the threads.
+ThreadPool::ThreadPool(int threads) : stopping(false) {
+	for (int i = 1; i < threads; i++) {
+		workers.push_back(thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> lock(batchMutex);
+		stopping = true;
+	}
+	batchReady.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+//Number of threads that work on a batch, including the caller.
+int ThreadPool::size() const {
+	return workers.size() + 1;
+}
+
+//Sets the number of threads used by the shared pool. Must be called before it is first used.
+void ThreadPool::setSharedThreads(int threads) {
+	sharedThreads = threads;
+}
+
+//Pool shared by the cave generation stages.
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool(sharedThreads > 0 ? sharedThreads : max(1, (int)thread::hardware_concurrency()));
+	return pool;
+}
+
+//Claims and runs one task of a batch. Returns false once every task has been claimed.
+bool ThreadPool::runTask(Batch &batch) {
+	size_t i = batch.next++;
+	if (i >= batch.count) { return false; }
+	(*batch.task)(i);
+	if (++batch.done == batch.count) {
+		lock_guard<mutex> lock(batchMutex);
+		batchDone.notify_all();
+	}
+	return true;
+}
+
+//Runs task(i) for every i in [0, count) and returns once all have finished.
+void ThreadPool::run(size_t count, const function<void(size_t)> &task) {
+	if (count == 0) { return; }
+	//Nothing to share the work with.
+	if (workers.empty() || count == 1) {
+		for (size_t i = 0; i < count; i++) { task(i); }
+		return;
+	}
+
+	shared_ptr<Batch> batch = make_shared<Batch>();
+	batch->task = &task;
+	batch->count = count;
+	batch->next = 0;
+	batch->done = 0;
+	{
+		lock_guard<mutex> lock(batchMutex);
+		batches.push_back(batch);
+	}
+	batchReady.notify_all();
+
+	//Works on the batch alongside the workers, then waits for tasks still running elsewhere.
+	while (runTask(*batch)) {}
+	unique_lock<mutex> lock(batchMutex);
+	batchDone.wait(lock, [&batch]() { return batch->done == batch->count; });
+}
+
+//Takes tasks from the oldest batch with unclaimed tasks.
+void ThreadPool::workerLoop() {
+	while (true) {
+		shared_ptr<Batch> batch;
+		{
+			unique_lock<mutex> lock(batchMutex);
+			batchReady.wait(lock, [this]() { return stopping || !batches.empty(); });
+			if (stopping) { return; }
+			batch = batches.front();
+			//Fully claimed batches are removed so workers move on to the next one.
+			if (batch->next >= batch->count) {
+				batches.pop_front();
+				continue;
+			}
+		}
+		runTask(*batch);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+using namespace std;
+
+//Fixed set of worker threads that run batches of indexed tasks.
+//The thread calling run() also works on its batch, so batches may be nested without deadlocking.
+class ThreadPool {
+public:
+  explicit ThreadPool(int threads);
+  ~ThreadPool();
+  int size() const;
+  void run(size_t count, const function<void(size_t)> &task);
+  static ThreadPool& shared();
+  static void setSharedThreads(int threads);
+private:
+  struct Batch {
+    const function<void(size_t)>* task;
+    size_t count;
+    atomic<size_t> next;
+    atomic<size_t> done;
+  };
+  vector<thread> workers;
+  deque<shared_ptr<Batch>> batches;
+  mutex batchMutex;
+  condition_variable batchReady;
+  condition_variable batchDone;
+  bool stopping;
+  static int sharedThreads;
+  void workerLoop();
+  bool runTask(Batch &batch);
+};
@@ -0,0 +1,234 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include "VisibilityCache.h"
+#include "FieldOfView.h"
+#include "CaveFile.h"
+#include "ThreadPool.h"
+#include "MapCell.h"
+using namespace std;
+
+const uint32_t VisibilityCache::version;
+const int VisibilityCache::maxRadius;
+
+VisibilityCache::VisibilityCache() : width(0), height(0), radius(0), method(Shadowcast), caveHash(0) {}
+
+//Senses from every free cell of the cave with the given method and stores the visible cells as runs.
+//Rows of origins are built as separate tasks, serially when threads is 1 and otherwise on the shared pool.
+//Returns false, leaving the cache empty, if the radius is too large or the build was cancelled.
+bool VisibilityCache::build(const CaveGrid &cave, float _radius, SenseMethod _method, int threads, const atomic<bool>* cancelled) {
+	clear();
+	if (_radius < 0 || _radius > maxRadius) { return false; }
+	const int w = cave.getWidth();
+	const int h = cave.getHeight();
+
+	vector<vector<VisibilityRun>> rowRuns(h);
+	vector<uint32_t> counts((size_t)w * h, 0);
+	auto buildRow = [&](size_t y) {
+		if (cancelled && *cancelled) { return; }
+		FieldOfView fieldOfView;
+		vector<SenseCell> freeCells, occupiedCells;
+		vector<uint8_t> scratch;
+		for (int x = 0; x < w; x++) {
+			if (cave(x, y) != Free) { continue; }
+			if (_method == Shadowcast) {
+				fieldOfView.shadowcast(cave, x, y, _radius, freeCells, occupiedCells);
+			}
+			else {
+				fieldOfView.raycast(cave, x, y, _radius, freeCells, occupiedCells);
+			}
+			size_t first = rowRuns[y].size();
+			toRuns(freeCells, occupiedCells, x, y, _radius, rowRuns[y], scratch);
+			counts[(size_t)y * w + x] = rowRuns[y].size() - first;
+		}
+	};
+	if (threads == 1) {
+		for (int y = 0; y < h; y++) {
+			buildRow(y);
+		}
+	}
+	else {
+		ThreadPool::shared().run(h, buildRow);
+	}
+	if (cancelled && *cancelled) { return false; }
+
+	//Joins the rows into one table.
+	offsets.resize((size_t)w * h + 1);
+	size_t total = 0;
+	for (size_t i = 0; i < counts.size(); i++) {
+		offsets[i] = total;
+		total += counts[i];
+	}
+	offsets.back() = total;
+	runs.reserve(total);
+	for (int y = 0; y < h; y++) {
+		runs.insert(runs.end(), rowRuns[y].begin(), rowRuns[y].end());
+	}
+	width = w;
+	height = h;
+	radius = _radius;
+	method = _method;
+	caveHash = CaveFile::gridHash(cave);
+	return true;
+}
+
+//Whether the cache was built for this cave with the given radius and method.
+//Only the dimensions are compared, as build and load already tie the cache to its cave.
+bool VisibilityCache::covers(const CaveGrid &cave, float _radius, SenseMethod _method) const {
+	return !empty() && width == cave.getWidth() && height == cave.getHeight() && radius == _radius && method == _method;
+}
+
+//Sensed cells of an origin, matching what FieldOfView returns apart from their order.
+//Returns false if the origin is not a free cell of the cave.
+bool VisibilityCache::lookup(const CaveGrid &cave, int x, int y, vector<SenseCell> &freeCells, vector<SenseCell> &occupiedCells) const {
+	freeCells.clear();
+	occupiedCells.clear();
+	if (x < 0 || y < 0 || x >= width || y >= height || cave(x, y) != Free) { return false; }
+	size_t cell = (size_t)y * width + x;
+	for (uint32_t r = offsets[cell]; r < offsets[cell + 1]; r++) {
+		const VisibilityRun &run = runs[r];
+		int cy = y + run.dy;
+		for (int cx = x + run.dx; cx < x + run.dx + run.length; cx++) {
+			SenseCell sensed(cx, cy, FieldOfView::distance(cx, cy, x, y));
+			if (cave(cx, cy) == Free) { freeCells.push_back(sensed); }
+			else { occupiedCells.push_back(sensed); }
+		}
+	}
+	return true;
+}
+
+//Copies the runs of an origin. Returns false if the origin is not a free cell of the cave.
+bool VisibilityCache::getRuns(int x, int y, vector<VisibilityRun> &out) const {
+	out.clear();
+	if (x < 0 || y < 0 || x >= width || y >= height) { return false; }
+	size_t cell = (size_t)y * width + x;
+	if (offsets[cell] == offsets[cell + 1]) { return false; } //Every free origin senses at least itself.
+	out.assign(runs.begin() + offsets[cell], runs.begin() + offsets[cell + 1]);
+	return true;
+}
+
+//Appends sensed cells to a list of runs relative to the origin (x, y) that sensed them within the radius.
+//The scratch buffer is reused between calls.
+void VisibilityCache::toRuns(const vector<SenseCell> &freeCells, const vector<SenseCell> &occupiedCells, int x, int y, float radius, vector<VisibilityRun> &out, vector<uint8_t> &scratch) {
+	const int reach = (int)floor(radius);
+	const int side = 2 * reach + 1;
+	scratch.resize((size_t)side * side, 0);
+
+	//Marks the sensed cells around the origin, then collects them row by row into runs.
+	for (const vector<SenseCell>* sensed : {&freeCells, &occupiedCells}) {
+		for (const SenseCell &cell : *sensed) {
+			scratch[(size_t)(cell.y - y + reach) * side + (cell.x - x + reach)] = 1;
+		}
+	}
+	for (int dy = 0; dy < side; dy++) {
+		uint8_t* row = scratch.data() + (size_t)dy * side;
+		for (int dx = 0; dx < side; dx++) {
+			if (!row[dx]) { continue; }
+			VisibilityRun run;
+			run.dy = (int8_t)(dy - reach);
+			run.dx = (int8_t)(dx - reach);
+			run.length = 0;
+			while (dx < side && row[dx]) {
+				row[dx++] = 0;
+				run.length++;
+			}
+			out.push_back(run);
+		}
+	}
+}
+
+//Reads a visibility file written by save, returning false unless it was built for this very cave.
+bool VisibilityCache::load(const string &path, const CaveGrid &cave) {
+	clear();
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) { return false; }
+	VisibilityFileHeader h;
+	bool valid = fread(&h, sizeof(h), 1, file) == 1 && memcmp(h.magic, "CVIS", 4) == 0 && h.version == version
+		&& h.width == cave.getWidth() && h.height == cave.getHeight() && h.radius >= 0 && h.radius <= maxRadius
+		&& (h.method == Raycast || h.method == Shadowcast) && h.caveHash == CaveFile::gridHash(cave);
+	if (valid) {
+		offsets.resize((size_t)h.width * h.height + 1);
+		valid = fread(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size() && offsets.back() == h.runCount;
+	}
+	if (valid) {
+		runs.resize(h.runCount);
+		valid = fread(runs.data(), sizeof(VisibilityRun), runs.size(), file) == runs.size();
+	}
+	fclose(file);
+
+	//Every run must lie within the cave, so lookups need no bounds checks.
+	for (int y = 0; valid && y < h.height; y++) {
+		for (int x = 0; valid && x < h.width; x++) {
+			size_t cell = (size_t)y * h.width + x;
+			if (offsets[cell] > offsets[cell + 1]) { valid = false; break; }
+			for (uint32_t r = offsets[cell]; r < offsets[cell + 1]; r++) {
+				const VisibilityRun &run = runs[r];
+				if (y + run.dy < 0 || y + run.dy >= h.height || x + run.dx < 0 || x + run.dx + run.length > h.width) { valid = false; break; }
+			}
+		}
+	}
+	if (!valid) {
+		clear();
+		return false;
+	}
+	width = h.width;
+	height = h.height;
+	radius = h.radius;
+	method = (SenseMethod)h.method;
+	caveHash = h.caveHash;
+	return true;
+}
+
+//Writes the cache under a temporary name and renames it into place, as CaveFile::save does.
+bool VisibilityCache::save(const string &path) const {
+	if (empty()) { return false; }
+	VisibilityFileHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "CVIS", 4);
+	h.version = version;
+	h.width = width;
+	h.height = height;
+	h.radius = radius;
+	h.method = method;
+	h.caveHash = caveHash;
+	h.runCount = runs.size();
+
+	string temporary = path + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (!file) { return false; }
+	bool written = fwrite(&h, sizeof(h), 1, file) == 1 && fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size()
+		&& fwrite(runs.data(), sizeof(VisibilityRun), runs.size(), file) == runs.size();
+	written = (fclose(file) == 0) && written;
+	if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+void VisibilityCache::clear() {
+	width = 0;
+	height = 0;
+	caveHash = 0;
+	vector<uint32_t>().swap(offsets);
+	vector<VisibilityRun>().swap(runs);
+}
+
+bool VisibilityCache::empty() const {
+	return offsets.empty();
+}
+
+size_t VisibilityCache::getRunCount() const {
+	return runs.size();
+}
+
+size_t VisibilityCache::getMemoryBytes() const {
+	return offsets.size() * sizeof(uint32_t) + runs.size() * sizeof(VisibilityRun);
+}
+
+//Path of the visibility file kept next to a cached cave file.
+string VisibilityCache::cachePath(const string &cavePath, float radius, SenseMethod method) {
+	char suffix[64];
+	snprintf(suffix, sizeof(suffix), ".r%g.%s.vis", radius, (method == Shadowcast) ? "shadowcast" : "raycast");
+	return cavePath + suffix;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include "CaveGrid.h"
+#include "SenseCell.h"
+#include "SenseMethod.h"
+using namespace std;
+
+//Fixed 40 byte header at the start of a visibility file, followed by the run offsets of every
+//cell (width * height + 1 values) and then the runs themselves.
+struct VisibilityFileHeader {
+  char magic[4]; //"CVIS".
+  uint32_t version; //Format version, files from other versions are ignored.
+  int32_t width;
+  int32_t height;
+  float radius; //Search radius the cells were sensed with.
+  int32_t method; //SenseMethod the cells were sensed with.
+  uint64_t caveHash; //CaveFile::gridHash of the cave, so a file is only used with its own cave.
+  uint64_t runCount;
+};
+static_assert(sizeof(VisibilityFileHeader) == 40, "Visibility file header must stay 40 bytes");
+
+//Row of cells visible from an origin: length cells starting at offset (dx, dy) from the origin.
+//The runs of an origin are ordered by dy, then dx.
+struct VisibilityRun {
+  int8_t dy;
+  int8_t dx;
+  uint8_t length;
+};
+
+//Cells sensed from every free cell of a cave within a search radius, so sensing becomes a table
+//lookup instead of a line of sight search. The cave never changes during a simulation, so the table
+//is built once per cave, on the shared thread pool, and may be saved next to the cached cave.
+//Each origin stores its visible cells as runs along rows, about 3 bytes for every row it sees into.
+//Cell states are read back from the cave, so the table holds only which cells are visible.
+class VisibilityCache {
+public:
+  static const uint32_t version = 1;
+  static const int maxRadius = 127; //Offsets of runs are single bytes.
+  VisibilityCache();
+  bool build(const CaveGrid &cave, float radius, SenseMethod method, int threads, const atomic<bool>* cancelled = nullptr);
+  bool covers(const CaveGrid &cave, float radius, SenseMethod method) const;
+  bool lookup(const CaveGrid &cave, int x, int y, vector<SenseCell> &freeCells, vector<SenseCell> &occupiedCells) const;
+  bool getRuns(int x, int y, vector<VisibilityRun> &out) const;
+  bool load(const string &path, const CaveGrid &cave);
+  bool save(const string &path) const;
+  void clear();
+  bool empty() const;
+  size_t getRunCount() const;
+  size_t getMemoryBytes() const;
+  static string cachePath(const string &cavePath, float radius, SenseMethod method);
+  static void toRuns(const vector<SenseCell> &freeCells, const vector<SenseCell> &occupiedCells, int x, int y, float radius, vector<VisibilityRun> &out, vector<uint8_t> &scratch);
+private:
+  int width;
+  int height;
+  float radius;
+  SenseMethod method;
+  uint64_t caveHash;
+  vector<uint32_t> offsets; //First run of each cell, row-major, with the total number of runs last.
+  vector<VisibilityRun> runs;
+};
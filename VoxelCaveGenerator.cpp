@@ -0,0 +1,453 @@
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "VoxelCaveGenerator.h"
+#include "SimplexNoise.h"
+#include "ThreadPool.h"
+#include "MapCell.h"
+using namespace std;
+
+const int VoxelCaveGenerator::border;
+const int VoxelCaveGenerator::birthThreshold;
+const int VoxelCaveGenerator::deathThreshold;
+
+static const int S = VoxelGrid::chunkSize;
+static const int P = VoxelGrid::chunkSize + 2; //Side of a chunk padded with its neighbouring voxels.
+
+VoxelCaveGenerator::VoxelCaveGenerator() : startCount(0), freeComponentCount(0) {}
+
+//Seconds elapsed since the given time, which is then moved on to now.
+static double lap(chrono::steady_clock::time_point &since) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(now - since).count();
+	since = now;
+	return seconds;
+}
+
+//Runs every generation stage, optionally timing each one and measuring the cave.
+void VoxelCaveGenerator::generate(const CaveParams &params, int depth, VoxelMetrics *metrics) {
+	VoxelMetrics unused;
+	VoxelMetrics &m = metrics ? *metrics : unused;
+	chrono::steady_clock::time_point time = chrono::steady_clock::now();
+
+	randomise(params, depth); //Uses 3D simplex noise to create a random cave.
+	m.randomiseTime = lap(time);
+	m.convergedIteration = smooth(params); //Uses cellular automata to smooth the cave voxels.
+	m.smoothTime = lap(time);
+	m.removedFreePockets = fillInaccessibleAreas(params); //Keeps only the largest free region.
+	m.fillTime = lap(time);
+
+	if (metrics) {
+		m.freeComponents = freeComponentCount;
+		m.largestComponent = startCount;
+		m.freeVoxels = voxels.countFree();
+		m.denseChunks = voxels.getDenseChunkCount();
+		m.memoryBytes = voxels.getMemoryBytes();
+	}
+}
+
+//Runs a task for every chunk, on the shared pool unless the parameters ask for a single thread.
+void VoxelCaveGenerator::forEachChunk(const CaveParams &params, const function<void(size_t)> &task) const {
+	forEachChunk(params, 0, voxels.getChunkCount(), task);
+}
+
+//Runs a task for the chunks [first, first + count).
+void VoxelCaveGenerator::forEachChunk(const CaveParams &params, size_t first, size_t count, const function<void(size_t)> &task) const {
+	if (params.threads == 1) {
+		for (size_t c = first; c < first + count; c++) {
+			task(c);
+		}
+	}
+	else {
+		ThreadPool::shared().run(count, [&](size_t i) { task(first + i); });
+	}
+}
+
+//Generates the initial cave by thresholding 3D simplex noise, leaving the border occupied.
+//Noise coordinates are scaled by the cave dimensions, matching the 2D caves along x and y.
+void VoxelCaveGenerator::randomise(const CaveParams &params, int depth) {
+	voxels.resize(params.width, params.height, depth, Occupied);
+	const float noiseThreshold = (params.fillPercentage / 50.0f) - 1.0f;
+	SimplexNoise noise = params.seed ? SimplexNoise(1.0f, 1.0f, params.lacunarity, params.persistence, params.seed) : SimplexNoise(1.0f, 1.0f, params.lacunarity, params.persistence);
+	const int width = params.width;
+	const int height = params.height;
+
+	forEachChunk(params, [&](size_t c) {
+		int cx, cy, cz;
+		voxels.chunkCoordinates(c, cx, cy, cz);
+		int x0 = max(cx * S, border), x1 = min((cx + 1) * S, width - border);
+		int y0 = max(cy * S, border), y1 = min((cy + 1) * S, height - border);
+		int z0 = max(cz * S, border), z1 = min((cz + 1) * S, depth - border);
+		if (x1 <= x0 || y1 <= y0 || z1 <= z0) { return; }
+
+		VoxelGrid &grid = voxels;
+		grid.makeDense(c);
+		uint64_t* bits = grid.chunkWordsOf(c);
+		for (int z = z0; z < z1; z++) {
+			float mappedZ = (float)z / depth * params.noiseScale;
+			for (int y = y0; y < y1; y++) {
+				float mappedY = (float)y / height * params.noiseScale + params.offsetY;
+				for (int x = x0; x < x1; x++) {
+					float mappedX = (float)x / width * params.noiseScale + params.offsetX;
+					float value = (params.octaves > 1) ? noise.fractal(params.octaves, mappedX, mappedY, mappedZ) : noise.sample(mappedX, mappedY, mappedZ);
+					if (value > noiseThreshold) {
+						int i = VoxelGrid::localIndex(x - cx * S, y - cy * S, z - cz * S);
+						bits[i >> 6] |= (uint64_t)1 << (i & 63);
+					}
+				}
+			}
+		}
+		grid.compact(c);
+	});
+}
+
+//Row of 16 voxels (free bits set) of the chunk column cx at (y, z), empty outside the grid.
+static uint32_t chunkRow(const VoxelGrid &grid, int cx, int y, int z) {
+	if (cx < 0 || cx >= grid.getChunksX() || y < 0 || y >= grid.getHeight() || z < 0 || z >= grid.getDepth()) { return 0; }
+	size_t c = grid.chunkIndex(cx, y / S, z / S);
+	if (grid.isUniform(c)) {
+		return (grid.getUniformValue(c) == Free) ? 0xFFFF : 0;
+	}
+	int i = VoxelGrid::localIndex(0, y % S, z % S);
+	return (grid.chunkWordsOf(c)[i >> 6] >> (i & 63)) & 0xFFFF;
+}
+
+//Copies a chunk and the layer of voxels around it into a padded P x P x P block, 1 for free voxels.
+static void gatherPadded(const VoxelGrid &grid, int cx, int cy, int cz, uint8_t* padded) {
+	for (int pz = 0; pz < P; pz++) {
+		int z = cz * S + pz - 1;
+		for (int py = 0; py < P; py++) {
+			int y = cy * S + py - 1;
+			uint8_t* out = padded + (pz * P + py) * P;
+			uint32_t row = chunkRow(grid, cx, y, z);
+			out[0] = (chunkRow(grid, cx - 1, y, z) >> (S - 1)) & 1;
+			for (int lx = 0; lx < S; lx++) {
+				out[lx + 1] = (row >> lx) & 1;
+			}
+			out[P - 1] = chunkRow(grid, cx + 1, y, z) & 1;
+		}
+	}
+}
+
+//Whether a chunk and its 26 neighbouring chunks are all uniformly the given state (missing chunks are occupied).
+static bool uniformNeighbourhood(const VoxelGrid &grid, int cx, int cy, int cz, uint8_t value) {
+	for (int dz = -1; dz <= 1; dz++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				int x = cx + dx, y = cy + dy, z = cz + dz;
+				if (x < 0 || y < 0 || z < 0 || x >= grid.getChunksX() || y >= grid.getChunksY() || z >= grid.getChunksZ()) {
+					if (value != Occupied) { return false; }
+					continue;
+				}
+				size_t c = grid.chunkIndex(x, y, z);
+				if (!grid.isUniform(c) || grid.getUniformValue(c) != value) { return false; }
+			}
+		}
+	}
+	return true;
+}
+
+//Smooths the cave by counting the free voxels among the 26 surrounding each voxel inside the border.
+//A voxel becomes free above the birth threshold, occupied below the death threshold and otherwise keeps its state.
+//Counts come from separable 3x3x3 box sums over each padded chunk. A uniform chunk surrounded by
+//chunks of the same state cannot change, so it is skipped without touching its voxels.
+//Returns the iterations after which the cave reached a fixed point, or -1 if it was still changing.
+int VoxelCaveGenerator::smooth(const CaveParams &params) {
+	const int width = voxels.getWidth();
+	const int height = voxels.getHeight();
+	const int depth = voxels.getDepth();
+	VoxelGrid next(width, height, depth, Occupied);
+	vector<char> changed(voxels.getChunkCount());
+
+	for (int iteration = 0; iteration < params.smoothIterations; iteration++) {
+		const VoxelGrid &src = voxels;
+		forEachChunk(params, [&](size_t c) {
+			int cx, cy, cz;
+			src.chunkCoordinates(c, cx, cy, cz);
+			changed[c] = 0;
+			if (src.isUniform(c) && uniformNeighbourhood(src, cx, cy, cz, src.getUniformValue(c))) {
+				next.setUniform(c, src.getUniformValue(c));
+				return;
+			}
+
+			uint8_t padded[P * P * P];
+			uint8_t sumX[P * P * S];
+			uint8_t sumY[P * S * S];
+			gatherPadded(src, cx, cy, cz, padded);
+			for (int i = 0; i < P * P; i++) {
+				const uint8_t* in = padded + i * P;
+				uint8_t* out = sumX + i * S;
+				for (int x = 0; x < S; x++) { out[x] = in[x] + in[x + 1] + in[x + 2]; }
+			}
+			for (int z = 0; z < P; z++) {
+				for (int y = 0; y < S; y++) {
+					const uint8_t* in = sumX + (z * P + y) * S;
+					uint8_t* out = sumY + (z * S + y) * S;
+					for (int x = 0; x < S; x++) { out[x] = in[x] + in[x + S] + in[x + 2 * S]; }
+				}
+			}
+
+			next.setUniform(c, Occupied);
+			next.makeDense(c);
+			uint64_t* bits = next.chunkWordsOf(c);
+			for (int lz = 0; lz < S; lz++) {
+				int z = cz * S + lz;
+				bool zInside = z >= border && z < depth - border;
+				for (int ly = 0; ly < S; ly++) {
+					int y = cy * S + ly;
+					bool inside = zInside && y >= border && y < height - border;
+					const uint8_t* below = sumY + (lz * S + ly) * S;
+					const uint8_t* cells = padded + ((lz + 1) * P + ly + 1) * P + 1;
+					uint32_t row = 0;
+					for (int lx = 0; lx < S; lx++) {
+						int x = cx * S + lx;
+						int count = below[lx] + below[lx + S * S] + below[lx + 2 * S * S] - cells[lx];
+						bool free = cells[lx];
+						if (inside && x >= border && x < width - border) {
+							free = count > birthThreshold || (free && count >= deathThreshold);
+						}
+						row |= (uint32_t)free << lx;
+					}
+					uint32_t old = 0;
+					for (int lx = 0; lx < S; lx++) { old |= (uint32_t)cells[lx] << lx; }
+					changed[c] |= (row != old);
+					int i = VoxelGrid::localIndex(0, ly, lz);
+					bits[i >> 6] |= (uint64_t)row << (i & 63);
+				}
+			}
+			next.compact(c);
+		});
+		swap(voxels, next);
+		if (find(changed.begin(), changed.end(), 1) == changed.end()) {
+			return iteration;
+		}
+	}
+	return -1;
+}
+
+//Free voxels of one chunk labelled by 6-connected region within the chunk, numbered from 1 in
+//order of their first voxel, with the labels of the voxels on each of the six chunk faces.
+struct ChunkComponents {
+	int count;
+	vector<int> sizes;
+	vector<int> firstVoxels; //Local index of the first voxel of each region.
+	vector<uint16_t> faces; //Six faces (-x, +x, -y, +y, -z, +z) of S x S labels, empty for uniform chunks.
+	ChunkComponents() : count(0) {}
+};
+
+static int findLocalRoot(int* parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+//Labels the free voxels of a dense chunk, writing each voxel's label (0 when occupied) to labels.
+static int labelChunk(const uint64_t* bits, uint16_t* labels, vector<int> &sizes, vector<int> &firstVoxels) {
+	int parent[VoxelGrid::chunkVoxels];
+	auto isFree = [bits](int i) { return (bits[i >> 6] >> (i & 63)) & 1; };
+	for (int i = 0; i < VoxelGrid::chunkVoxels; i++) {
+		if (!isFree(i)) { continue; }
+		parent[i] = i;
+		const int lx = i & (S - 1);
+		const int ly = (i / S) & (S - 1);
+		const int lz = i / (S * S);
+		const int neighbours[3] = { lx > 0 ? i - 1 : -1, ly > 0 ? i - S : -1, lz > 0 ? i - S * S : -1 };
+		for (int n : neighbours) {
+			if (n >= 0 && isFree(n)) {
+				int a = findLocalRoot(parent, n);
+				int b = findLocalRoot(parent, i);
+				if (a != b) { parent[max(a, b)] = min(a, b); }
+			}
+		}
+	}
+
+	//Roots are the lowest voxel of their region, so numbering roots in order numbers regions by first voxel.
+	int count = 0;
+	sizes.clear();
+	firstVoxels.clear();
+	for (int i = 0; i < VoxelGrid::chunkVoxels; i++) {
+		if (!isFree(i)) {
+			labels[i] = 0;
+			continue;
+		}
+		int root = findLocalRoot(parent, i);
+		if (root == i) {
+			labels[i] = (uint16_t)++count;
+			sizes.push_back(0);
+			firstVoxels.push_back(i);
+		}
+		else {
+			labels[i] = labels[root];
+		}
+		sizes[labels[i] - 1]++;
+	}
+	return count;
+}
+
+//Label of a face voxel, a and b being its coordinates along the two axes of the face in order x, y, z.
+static uint16_t faceLabel(const ChunkComponents &chunk, int face, int a, int b) {
+	if (chunk.faces.empty()) { return chunk.count ? 1 : 0; }
+	return chunk.faces[(face * S + b) * S + a];
+}
+
+static int findRoot(vector<int> &parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+//Labels the 6-connected free regions of the cave, keeps the largest as the cave and fills in the rest.
+//Regions are labelled within each chunk in parallel, then joined across chunk faces by a union-find
+//over the regions, so no label is ever stored per voxel for the whole cave. Chunks are labelled one
+//layer of chunks at a time, keeping face labels only until the next layer has been joined to them.
+//The start voxel is the first voxel of the largest region, found in chunk order.
+//Returns the number of regions filled in.
+int VoxelCaveGenerator::fillInaccessibleAreas(const CaveParams &params) {
+	const size_t chunkCount = voxels.getChunkCount();
+	const size_t layerChunks = (size_t)voxels.getChunksX() * voxels.getChunksY();
+	vector<ChunkComponents> chunks(chunkCount);
+	vector<int> base(chunkCount + 1, 0); //First region number of each chunk.
+	vector<int> parent;
+
+	//Joins the regions of two chunks meeting across a face of the first chunk and the opposite face of the second.
+	auto joinFaces = [&](size_t c, size_t other, int face) {
+		if (chunks[c].count == 0 || chunks[other].count == 0) { return; }
+		for (int b = 0; b < S; b++) {
+			for (int a = 0; a < S; a++) {
+				uint16_t la = faceLabel(chunks[c], face, a, b);
+				uint16_t lb = faceLabel(chunks[other], face ^ 1, a, b);
+				if (la && lb) {
+					int ra = findRoot(parent, base[c] + la - 1);
+					int rb = findRoot(parent, base[other] + lb - 1);
+					if (ra != rb) { parent[max(ra, rb)] = min(ra, rb); }
+				}
+			}
+		}
+	};
+
+	for (int cz = 0; cz < voxels.getChunksZ(); cz++) {
+		const size_t first = cz * layerChunks;
+		forEachChunk(params, first, layerChunks, [&](size_t c) {
+			ChunkComponents &chunk = chunks[c];
+			if (voxels.isUniform(c)) {
+				if (voxels.getUniformValue(c) == Free) {
+					chunk.count = 1;
+					chunk.sizes.assign(1, (int)VoxelGrid::chunkVoxels);
+					chunk.firstVoxels.assign(1, 0);
+				}
+				return;
+			}
+			uint16_t labels[VoxelGrid::chunkVoxels];
+			chunk.count = labelChunk(voxels.chunkWordsOf(c), labels, chunk.sizes, chunk.firstVoxels);
+			chunk.faces.resize(6 * S * S);
+			for (int b = 0; b < S; b++) {
+				for (int a = 0; a < S; a++) {
+					chunk.faces[(0 * S + b) * S + a] = labels[VoxelGrid::localIndex(0, a, b)];
+					chunk.faces[(1 * S + b) * S + a] = labels[VoxelGrid::localIndex(S - 1, a, b)];
+					chunk.faces[(2 * S + b) * S + a] = labels[VoxelGrid::localIndex(a, 0, b)];
+					chunk.faces[(3 * S + b) * S + a] = labels[VoxelGrid::localIndex(a, S - 1, b)];
+					chunk.faces[(4 * S + b) * S + a] = labels[VoxelGrid::localIndex(a, b, 0)];
+					chunk.faces[(5 * S + b) * S + a] = labels[VoxelGrid::localIndex(a, b, S - 1)];
+				}
+			}
+		});
+
+		//Numbers the regions of the layer, chunk by chunk.
+		for (size_t c = first; c < first + layerChunks; c++) {
+			base[c + 1] = base[c] + chunks[c].count;
+		}
+		for (int i = base[first]; i < base[first + layerChunks]; i++) {
+			parent.push_back(i);
+		}
+
+		//Joins regions across the faces within the layer and with the layer below, whose faces are then released.
+		for (size_t c = first; c < first + layerChunks; c++) {
+			int cx, cy, unused;
+			voxels.chunkCoordinates(c, cx, cy, unused);
+			if (cx + 1 < voxels.getChunksX()) { joinFaces(c, c + 1, 1); }
+			if (cy + 1 < voxels.getChunksY()) { joinFaces(c, c + voxels.getChunksX(), 3); }
+			if (cz > 0) { joinFaces(c, c - layerChunks, 4); }
+		}
+		for (size_t c = first - (cz > 0 ? layerChunks : 0); cz > 0 && c < first; c++) {
+			vector<uint16_t>().swap(chunks[c].faces);
+		}
+	}
+
+	//Sizes every region and finds the largest, the lowest numbered one on a tie.
+	vector<int> root(parent.size());
+	vector<int64_t> sizes(parent.size(), 0);
+	freeComponentCount = 0;
+	for (size_t c = 0; c < chunkCount; c++) {
+		for (int k = 0; k < chunks[c].count; k++) {
+			int i = base[c] + k;
+			root[i] = findRoot(parent, i);
+			freeComponentCount += (root[i] == i);
+			sizes[root[i]] += chunks[c].sizes[k];
+		}
+	}
+	int largest = -1;
+	for (size_t i = 0; i < sizes.size(); i++) {
+		if (root[i] == (int)i && (largest < 0 || sizes[i] > sizes[largest])) { largest = (int)i; }
+	}
+	startVoxel = Voxel(0, 0, 0);
+	startCount = (largest >= 0) ? sizes[largest] : 0;
+	bool startFound = false;
+	for (size_t c = 0; c < chunkCount && !startFound; c++) {
+		for (int k = 0; k < chunks[c].count; k++) {
+			if (root[base[c] + k] == largest) {
+				int cx, cy, cz;
+				voxels.chunkCoordinates(c, cx, cy, cz);
+				int i = chunks[c].firstVoxels[k];
+				startVoxel = Voxel(cx * S + (i & (S - 1)), cy * S + ((i / S) & (S - 1)), cz * S + i / (S * S));
+				startFound = true;
+				break;
+			}
+		}
+	}
+
+	//Fills every other region, labelling dense chunks again rather than keeping their labels.
+	forEachChunk(params, [&](size_t c) {
+		const ChunkComponents &chunk = chunks[c];
+		bool keepAll = true;
+		for (int k = 0; k < chunk.count; k++) {
+			keepAll = keepAll && root[base[c] + k] == largest;
+		}
+		if (keepAll) { return; }
+		if (voxels.isUniform(c)) {
+			voxels.setUniform(c, Occupied);
+			return;
+		}
+		uint16_t labels[VoxelGrid::chunkVoxels];
+		vector<int> localSizes, localFirst;
+		uint64_t* bits = voxels.chunkWordsOf(c);
+		labelChunk(bits, labels, localSizes, localFirst);
+		for (int i = 0; i < VoxelGrid::chunkVoxels; i++) {
+			if (labels[i] && root[base[c] + labels[i] - 1] != largest) {
+				bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+			}
+		}
+		voxels.compact(c);
+	});
+
+	return max(freeComponentCount - 1, 0);
+}
+
+const VoxelGrid& VoxelCaveGenerator::getVoxels() const {
+	return voxels;
+}
+
+Voxel VoxelCaveGenerator::getStartVoxel() const {
+	return startVoxel;
+}
+
+int64_t VoxelCaveGenerator::getStartCount() const {
+	return startCount;
+}
+
+int VoxelCaveGenerator::getFreeComponentCount() const {
+	return freeComponentCount;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "VoxelGrid.h"
+#include "CaveGenerator.h"
+using namespace std;
+
+//Measurements of one voxel cave generation run, filled in by VoxelCaveGenerator::generate when requested.
+struct VoxelMetrics {
+  double randomiseTime; //Seconds spent in each stage.
+  double smoothTime;
+  double fillTime;
+  int convergedIteration; //Iterations after which smoothing reached a fixed point, -1 if it did not.
+  int freeComponents; //Free regions after smoothing.
+  int64_t largestComponent; //Voxels in the largest free region after smoothing.
+  int removedFreePockets; //Free regions filled in as inaccessible.
+  int64_t freeVoxels; //Free voxels in the finished cave.
+  size_t denseChunks; //Chunks storing their voxels in the finished cave.
+  size_t memoryBytes; //Bytes used by the finished cave.
+  VoxelMetrics() : randomiseTime(0), smoothTime(0), fillTime(0), convergedIteration(-1), freeComponents(0),
+    largestComponent(0), removedFreePockets(0), freeVoxels(0), denseChunks(0), memoryBytes(0) {}
+};
+
+//Generates multi-level 3D caves: 3D simplex noise thresholded into voxels, smoothed by a cellular
+//automaton over the 26 surrounding voxels, then reduced to the largest free region, which is
+//6-connected (voxels sharing a face). The cave is held in a sparse VoxelGrid and every stage works
+//chunk by chunk on the shared thread pool, so memory follows the cave walls rather than the volume.
+//Uses the size, noise, iteration and thread parameters of CaveParams; the 2D rule is not used.
+class VoxelCaveGenerator {
+public:
+  static const int border = 3; //Padding of the cave border.
+  static const int birthThreshold = 13; //Free neighbours (of 26) above which a voxel becomes free.
+  static const int deathThreshold = 13; //Free neighbours below which a free voxel becomes occupied.
+  VoxelCaveGenerator();
+  void generate(const CaveParams &params, int depth, VoxelMetrics *metrics = nullptr);
+  void randomise(const CaveParams &params, int depth);
+  int smooth(const CaveParams &params);
+  int fillInaccessibleAreas(const CaveParams &params);
+  const VoxelGrid& getVoxels() const;
+  Voxel getStartVoxel() const;
+  int64_t getStartCount() const;
+  int getFreeComponentCount() const;
+private:
+  VoxelGrid voxels;
+  Voxel startVoxel;
+  int64_t startCount; //Number of voxels connected to the start voxel.
+  int freeComponentCount; //Free regions found by fillInaccessibleAreas.
+  void forEachChunk(const CaveParams &params, const function<void(size_t)> &task) const;
+  void forEachChunk(const CaveParams &params, size_t first, size_t count, const function<void(size_t)> &task) const;
+};
@@ -0,0 +1,195 @@
+#ifndef VOXELGRID_H
+#define VOXELGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "MapCell.h"
+using namespace std;
+
+//Position of a voxel in a voxel grid.
+struct Voxel {
+  int x;
+  int y;
+  int z;
+  Voxel() : x(0), y(0), z(0) {}
+  Voxel(int _x, int _y, int _z) : x(_x), y(_y), z(_z) {}
+};
+
+//Sparse voxel grid of free and occupied cells split into 16x16x16 chunks.
+//A chunk whose voxels all share one state stores just that state, and only the remaining
+//chunks hold their voxels, as one bit per voxel (set when free) in 64 words. Rock and open
+//space far from the cave walls therefore cost almost nothing, so memory follows the walls.
+//Voxels in chunks that overhang the grid, and voxels outside it, are occupied.
+class VoxelGrid {
+public:
+  static const int chunkBits = 4;
+  static const int chunkSize = 1 << chunkBits; //Voxels along each side of a chunk.
+  static const int chunkVoxels = chunkSize * chunkSize * chunkSize;
+  static const int chunkWords = chunkVoxels / 64;
+
+  VoxelGrid() : width(0), height(0), depth(0), chunksX(0), chunksY(0), chunksZ(0) {}
+  VoxelGrid(int _width, int _height, int _depth, uint8_t value) { resize(_width, _height, _depth, value); }
+
+  //Resizes the grid, setting every voxel to the given value and releasing every chunk.
+  void resize(int _width, int _height, int _depth, uint8_t value) {
+    width = _width;
+    height = _height;
+    depth = _depth;
+    chunksX = (width + chunkSize - 1) >> chunkBits;
+    chunksY = (height + chunkSize - 1) >> chunkBits;
+    chunksZ = (depth + chunkSize - 1) >> chunkBits;
+    chunks.assign((size_t)chunksX * chunksY * chunksZ, Chunk());
+    for (Chunk &chunk : chunks) {
+      chunk.value = value;
+    }
+    //Overhanging chunks keep their outside voxels occupied.
+    for (size_t c = 0; value == Free && c < chunks.size(); c++) {
+      if (overhangs(c)) {
+        makeDense(c);
+        clearOutside(c);
+      }
+    }
+  }
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  int getDepth() const { return depth; }
+  int getChunksX() const { return chunksX; }
+  int getChunksY() const { return chunksY; }
+  int getChunksZ() const { return chunksZ; }
+  size_t getChunkCount() const { return chunks.size(); }
+  bool contains(int x, int y, int z) const { return x >= 0 && y >= 0 && z >= 0 && x < width && y < height && z < depth; }
+
+  size_t chunkIndex(int cx, int cy, int cz) const { return ((size_t)cz * chunksY + cy) * chunksX + cx; }
+  void chunkCoordinates(size_t c, int &cx, int &cy, int &cz) const {
+    cx = (int)(c % chunksX);
+    cy = (int)((c / chunksX) % chunksY);
+    cz = (int)(c / ((size_t)chunksX * chunksY));
+  }
+
+  //Position of a voxel within its chunk, in the order of the chunk bits.
+  static int localIndex(int lx, int ly, int lz) { return (((lz << chunkBits) | ly) << chunkBits) | lx; }
+
+  uint8_t get(int x, int y, int z) const {
+    if (!contains(x, y, z)) { return Occupied; }
+    const Chunk &chunk = chunks[chunkIndex(x >> chunkBits, y >> chunkBits, z >> chunkBits)];
+    if (chunk.bits.empty()) { return chunk.value; }
+    int i = localIndex(x & (chunkSize - 1), y & (chunkSize - 1), z & (chunkSize - 1));
+    return ((chunk.bits[i >> 6] >> (i & 63)) & 1) ? Free : Occupied;
+  }
+
+  //Sets a voxel inside the grid, storing its chunk's voxels if the chunk was uniform.
+  void set(int x, int y, int z, uint8_t value) {
+    size_t c = chunkIndex(x >> chunkBits, y >> chunkBits, z >> chunkBits);
+    Chunk &chunk = chunks[c];
+    if (chunk.bits.empty()) {
+      if (chunk.value == value) { return; }
+      makeDense(c);
+    }
+    int i = localIndex(x & (chunkSize - 1), y & (chunkSize - 1), z & (chunkSize - 1));
+    uint64_t bit = (uint64_t)1 << (i & 63);
+    if (value == Free) { chunk.bits[i >> 6] |= bit; } else { chunk.bits[i >> 6] &= ~bit; }
+  }
+
+  //Chunk level access. Chunks may be written concurrently as long as each thread owns its chunks.
+  bool isUniform(size_t c) const { return chunks[c].bits.empty(); }
+  uint8_t getUniformValue(size_t c) const { return chunks[c].value; }
+  uint64_t* chunkWordsOf(size_t c) { return chunks[c].bits.data(); }
+  const uint64_t* chunkWordsOf(size_t c) const { return chunks[c].bits.data(); }
+
+  void setUniform(size_t c, uint8_t value) {
+    chunks[c].value = value;
+    vector<uint64_t>().swap(chunks[c].bits);
+  }
+
+  //Stores the voxels of a chunk, keeping their state.
+  void makeDense(size_t c) {
+    Chunk &chunk = chunks[c];
+    if (!chunk.bits.empty()) { return; }
+    chunk.bits.assign(chunkWords, (chunk.value == Free) ? ~(uint64_t)0 : 0);
+  }
+
+  //Releases the voxels of a chunk that turned out uniform. Returns whether it is now uniform.
+  bool compact(size_t c) {
+    Chunk &chunk = chunks[c];
+    if (chunk.bits.empty()) { return true; }
+    uint64_t all = ~(uint64_t)0;
+    uint64_t none = 0;
+    for (int k = 0; k < chunkWords; k++) {
+      all &= chunk.bits[k];
+      none |= chunk.bits[k];
+    }
+    if (all == ~(uint64_t)0) { setUniform(c, Free); return true; }
+    if (none == 0) { setUniform(c, Occupied); return true; }
+    return false;
+  }
+
+  //Clears the bits of a dense chunk's voxels that lie outside the grid.
+  void clearOutside(size_t c) {
+    int cx, cy, cz;
+    chunkCoordinates(c, cx, cy, cz);
+    uint64_t* bits = chunks[c].bits.data();
+    for (int lz = 0; lz < chunkSize; lz++) {
+      for (int ly = 0; ly < chunkSize; ly++) {
+        for (int lx = 0; lx < chunkSize; lx++) {
+          if (!contains((cx << chunkBits) + lx, (cy << chunkBits) + ly, (cz << chunkBits) + lz)) {
+            int i = localIndex(lx, ly, lz);
+            bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+          }
+        }
+      }
+    }
+  }
+
+  //Whether part of a chunk lies outside the grid.
+  bool overhangs(size_t c) const {
+    int cx, cy, cz;
+    chunkCoordinates(c, cx, cy, cz);
+    return ((cx + 1) << chunkBits) > width || ((cy + 1) << chunkBits) > height || ((cz + 1) << chunkBits) > depth;
+  }
+
+  size_t getDenseChunkCount() const {
+    size_t count = 0;
+    for (const Chunk &chunk : chunks) {
+      count += !chunk.bits.empty();
+    }
+    return count;
+  }
+
+  //Bytes used by the chunk table and the stored voxels.
+  size_t getMemoryBytes() const {
+    return chunks.size() * sizeof(Chunk) + getDenseChunkCount() * chunkWords * sizeof(uint64_t);
+  }
+
+  size_t countFree() const {
+    size_t count = 0;
+    for (const Chunk &chunk : chunks) {
+      if (chunk.bits.empty()) {
+        count += (chunk.value == Free) ? chunkVoxels : 0;
+      }
+      else {
+        for (uint64_t word : chunk.bits) {
+          count += __builtin_popcountll(word);
+        }
+      }
+    }
+    return count;
+  }
+
+private:
+  struct Chunk {
+    uint8_t value; //State of every voxel while the chunk is uniform.
+    vector<uint64_t> bits; //Voxels of a non-uniform chunk, empty while it is uniform.
+    Chunk() : value(Occupied) {}
+  };
+  int width;
+  int height;
+  int depth;
+  int chunksX;
+  int chunksY;
+  int chunksZ;
+  vector<Chunk> chunks; //Chunks ordered by x, then y, then z.
+};
+
+#endif
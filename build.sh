@@ -1 +1,5 @@
-g++ -o main main.cpp SimplexNoise.cpp Draw.cpp Drone.cpp Config.cpp -I -L/usr/X11R6/lib -lglut -lGL -lGLU -lX11 -lm -lpng -lpthread -std=c++11
+g++ -O2 -o main main.cpp SimplexNoise.cpp Draw.cpp Drone.cpp FieldOfView.cpp Config.cpp CellularAutomata.cpp ThreadPool.cpp ConnectedComponents.cpp CaveGenerator.cpp CaveFile.cpp CaveWorker.cpp VisibilityCache.cpp -I -L/usr/X11R6/lib -lglut -lGL -lGLU -lX11 -lm -lpng -lpthread -std=c++11
+g++ -O2 -o cavegen cavegen.cpp CaveGenerator.cpp CaveFile.cpp ChunkedCave.cpp VoxelCaveGenerator.cpp SimplexNoise.cpp CellularAutomata.cpp ThreadPool.cpp ConnectedComponents.cpp -lpthread -std=c++11
+g++ -O2 -o cavesweep cavesweep.cpp CaveSweep.cpp CaveGenerator.cpp SimplexNoise.cpp CellularAutomata.cpp ThreadPool.cpp ConnectedComponents.cpp -lpthread -std=c++11
+g++ -O2 -o cavebench cavebench.cpp CaveGenerator.cpp Config.cpp SimplexNoise.cpp CellularAutomata.cpp ThreadPool.cpp ConnectedComponents.cpp -lpthread -std=c++11
+g++ -O2 -o fovcheck fovcheck.cpp FieldOfView.cpp CaveGenerator.cpp Config.cpp SimplexNoise.cpp CellularAutomata.cpp ThreadPool.cpp ConnectedComponents.cpp -lpthread -std=c++11
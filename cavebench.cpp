@@ -0,0 +1,322 @@
+//Benchmark of the cave generation stages.
+//Times every CaveGenerator stage on the five presets of config.txt and on large synthetic caves,
+//repeating each cave a number of times after some untimed warm-up runs. Reports nanoseconds per
+//cell, throughput and the spread between runs as JSON, so runs from different builds can be compared.
+//Occupied pocket removal is timed on every cave, although generation skips it for odd iterations.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include "CaveGenerator.h"
+#include "CellularAutomata.h"
+#include "ThreadPool.h"
+#include "Config.h"
+using namespace std;
+
+const int stageCount = 5;
+const char* stageNames[stageCount] = {"randomise", "smooth", "find_start_cell", "fill_inaccessible_areas", "remove_non_border_occupied_areas"};
+
+//Cave timed by the benchmark.
+struct BenchCase {
+	string name;
+	CaveParams params;
+	vector<double> seconds[stageCount + 1]; //Seconds of each timed run of every stage, then of the whole run.
+};
+
+//Spread of the timed runs of one stage, in nanoseconds per cell.
+struct BenchStats {
+	double mean;
+	double variance;
+	double deviation;
+	double min;
+	double max;
+	double median;
+};
+
+void printUsage() {
+	cout << "Usage: cavebench [options]" << endl;
+	cout << "  -n RUNS         Timed runs of each cave (default 5)." << endl;
+	cout << "  -W RUNS         Untimed warm-up runs of each cave (default 1)." << endl;
+	cout << "  -g SIZES        Comma separated sides of the square synthetic caves, 0 for none (default 1024,2048)." << endl;
+	cout << "  -P 0|1          Benchmarks the presets of config.txt (default 1)." << endl;
+	cout << "  -s SEED         Noise seed of the synthetic caves (default 1)." << endl;
+	cout << "  -f FILL         Fill percentage of the synthetic caves (default 50)." << endl;
+	cout << "  -c SCALE        Noise scale of the synthetic caves (default 50)." << endl;
+	cout << "  -i ITERATIONS   Smoothing iterations of the synthetic caves (default 10)." << endl;
+	cout << "  -O OCTAVES      Octaves of fractal noise (default 1)." << endl;
+	cout << "  -R RULE         Cellular automata B/S rule (default B5678/S45678)." << endl;
+	cout << "  -r RADIUS       Neighbourhood radius of the rule (default 1)." << endl;
+	cout << "  -I 0|1          Incremental smoothing, 0 smooths every cell each iteration (default 1)." << endl;
+	cout << "  -j THREADS      Threads used by each stage, 0 uses every hardware thread (default 0)." << endl;
+	cout << "  -o FILE         Output JSON (default standard output)." << endl;
+}
+
+//Seconds elapsed since the given time, which is then moved on to now.
+double lap(chrono::steady_clock::time_point &since) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(now - since).count();
+	since = now;
+	return seconds;
+}
+
+//Runs every stage of a cave once, in the order of CaveGenerator::generate, recording the seconds of each.
+void runStages(const CaveParams &params, double seconds[stageCount]) {
+	CaveGenerator generator;
+	chrono::steady_clock::time_point time = chrono::steady_clock::now();
+	generator.randomise(params);
+	seconds[0] = lap(time);
+	generator.smooth(params);
+	seconds[1] = lap(time);
+	generator.findStartCell(params);
+	seconds[2] = lap(time);
+	generator.fillInaccessibleAreas();
+	seconds[3] = lap(time);
+	generator.removeNonBorderOccupiedAreas(params);
+	seconds[4] = lap(time);
+}
+
+BenchStats measure(const vector<double> &seconds, double cells) {
+	vector<double> ns;
+	for (double s : seconds) {
+		ns.push_back(s * 1e9 / cells);
+	}
+	BenchStats stats;
+	stats.mean = 0;
+	for (double v : ns) {
+		stats.mean += v;
+	}
+	stats.mean /= ns.size();
+	stats.variance = 0;
+	for (double v : ns) {
+		stats.variance += (v - stats.mean) * (v - stats.mean);
+	}
+	stats.variance = (ns.size() > 1) ? stats.variance / (ns.size() - 1) : 0;
+	stats.deviation = sqrt(stats.variance);
+	sort(ns.begin(), ns.end());
+	stats.min = ns.front();
+	stats.max = ns.back();
+	stats.median = (ns.size() % 2) ? ns[ns.size() / 2] : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+	return stats;
+}
+
+string jsonString(const string &s) {
+	string quoted = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\') { quoted += '\\'; }
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+//Writes one stage of a case, with every timed run so other tools can redo the statistics.
+void writeStage(ostream &json, const string &name, const vector<double> &seconds, double cells) {
+	BenchStats stats = measure(seconds, cells);
+	json << "        {\"stage\": " << jsonString(name)
+		<< ", \"ns_per_cell\": " << stats.mean << ", \"variance\": " << stats.variance << ", \"stddev\": " << stats.deviation
+		<< ", \"min\": " << stats.min << ", \"median\": " << stats.median << ", \"max\": " << stats.max
+		<< ", \"mcells_per_s\": " << ((stats.mean > 0) ? 1e3 / stats.mean : 0) << ", \"runs_s\": [";
+	for (size_t i = 0; i < seconds.size(); i++) {
+		json << (i ? ", " : "") << seconds[i];
+	}
+	json << "]}";
+}
+
+void writeJSON(ostream &json, const vector<BenchCase> &cases, const CaveParams &base, int runs, int warmup) {
+	json.precision(6);
+	json << "{" << endl;
+	json << "  \"compiler\": " << jsonString(__VERSION__) << "," << endl;
+	json << "  \"threads\": " << ThreadPool::shared().size() << "," << endl;
+	json << "  \"hardware_threads\": " << thread::hardware_concurrency() << "," << endl;
+	json << "  \"runs\": " << runs << "," << endl;
+	json << "  \"warmup\": " << warmup << "," << endl;
+	json << "  \"rule\": " << jsonString(base.rule) << "," << endl;
+	json << "  \"radius\": " << base.ruleRadius << "," << endl;
+	json << "  \"incremental\": " << (base.incremental ? "true" : "false") << "," << endl;
+	json << "  \"cases\": [" << endl;
+	for (size_t c = 0; c < cases.size(); c++) {
+		const BenchCase &bench = cases[c];
+		const CaveParams &p = bench.params;
+		double cells = (double)p.width * p.height;
+		json << "    {\"name\": " << jsonString(bench.name) << ", \"width\": " << p.width << ", \"height\": " << p.height
+			<< ", \"cells\": " << (int64_t)cells << ", \"seed\": " << p.seed << ", \"offset_x\": " << p.offsetX << ", \"offset_y\": " << p.offsetY
+			<< ", \"fill\": " << p.fillPercentage << ", \"scale\": " << p.noiseScale << ", \"iterations\": " << p.smoothIterations
+			<< ", \"octaves\": " << p.octaves << "," << endl;
+		json << "      \"stages\": [" << endl;
+		for (int s = 0; s <= stageCount; s++) {
+			writeStage(json, (s < stageCount) ? stageNames[s] : "total", bench.seconds[s], cells);
+			json << ((s < stageCount) ? "," : "") << endl;
+		}
+		json << "      ]}" << ((c + 1 < cases.size()) ? "," : "") << endl;
+	}
+	json << "  ]" << endl;
+	json << "}" << endl;
+}
+
+//Presets of config.txt, with the cave dimensions and seeds it sets. Returns false if there is no config.txt.
+bool readPresets(const CaveParams &base, vector<BenchCase> &cases) {
+	if (!ifstream("config.txt")) { return false; }
+	ConfigSettings settings;
+	settings.caveW = base.width;
+	settings.caveH = base.height;
+
+	//The config reader reports to standard output, which may carry the JSON.
+	streambuf* output = cout.rdbuf(cerr.rdbuf());
+	Config::readConfig(settings);
+	cout.rdbuf(output);
+
+	for (int i = 0; i < 5; i++) {
+		BenchCase bench;
+		bench.name = "preset_" + to_string(i + 1);
+		bench.params = base;
+		bench.params.width = settings.caveW;
+		bench.params.height = settings.caveH;
+		bench.params.offsetX = settings.presets[i][0];
+		bench.params.offsetY = settings.presets[i][1];
+		bench.params.fillPercentage = settings.presets[i][2];
+		bench.params.noiseScale = settings.presets[i][3];
+		bench.params.smoothIterations = settings.presets[i][4];
+		bench.params.seed = settings.seeds[i];
+		cases.push_back(bench);
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+
+	CaveParams base;
+	base.seed = 1;
+	int runs = 5;
+	int warmup = 1;
+	string sizes = "1024,2048";
+	bool usePresets = true;
+	int threads = 0;
+	string outputFile;
+
+	//Reads the options.
+	try {
+		for (int i = 1; i < argc; i++) {
+			string option = argv[i];
+			if (option == "--help") { printUsage(); return 0; }
+			if (option.size() != 2 || option[0] != '-' || i + 1 >= argc) {
+				printUsage();
+				return 1;
+			}
+			string value = argv[++i];
+			switch (option[1]) {
+				case 'n': runs = stoi(value); break;
+				case 'W': warmup = stoi(value); break;
+				case 'g': sizes = value; break;
+				case 'P': usePresets = stoi(value) != 0; break;
+				case 's': base.seed = stoull(value); break;
+				case 'f': base.fillPercentage = stof(value); break;
+				case 'c': base.noiseScale = stof(value); break;
+				case 'i': base.smoothIterations = stoi(value); break;
+				case 'O': base.octaves = stoi(value); break;
+				case 'R': base.rule = value; break;
+				case 'r': base.ruleRadius = stoi(value); break;
+				case 'I': base.incremental = stoi(value) != 0; break;
+				case 'j': threads = stoi(value); break;
+				case 'o': outputFile = value; break;
+				default: printUsage(); return 1;
+			}
+		}
+	}
+	catch (const exception &e) {
+		cerr << "Invalid option value." << endl;
+		printUsage();
+		return 1;
+	}
+	try {
+		CellularRule::parse(base.rule, base.ruleRadius);
+	}
+	catch (const invalid_argument &e) {
+		cerr << e.what() << "." << endl;
+		printUsage();
+		return 1;
+	}
+	if (runs < 1 || warmup < 0) {
+		cerr << "Runs must be positive." << endl;
+		return 1;
+	}
+
+	//Presets first, then the synthetic caves from smallest to largest.
+	vector<BenchCase> cases;
+	if (usePresets && !readPresets(base, cases)) {
+		cerr << "No config.txt, skipping the presets." << endl;
+	}
+	try {
+		stringstream list(sizes);
+		string size;
+		while (getline(list, size, ',')) {
+			int side = stoi(size);
+			if (side <= 0) { continue; }
+			BenchCase bench;
+			bench.name = "synthetic_" + to_string(side);
+			bench.params = base;
+			bench.params.width = side;
+			bench.params.height = side;
+			cases.push_back(bench);
+		}
+	}
+	catch (const exception &e) {
+		cerr << "Invalid synthetic cave sizes." << endl;
+		printUsage();
+		return 1;
+	}
+	if (cases.empty()) {
+		cerr << "Nothing to benchmark." << endl;
+		return 1;
+	}
+
+	ofstream file;
+	if (!outputFile.empty()) {
+		file.open(outputFile.c_str());
+		if (!file) {
+			cerr << "Unable to open " << outputFile << "." << endl;
+			return 1;
+		}
+	}
+	ostream &json = outputFile.empty() ? cout : file;
+
+	//Caves run one at a time, each stage spreading its work across the shared pool.
+	ThreadPool::setSharedThreads(threads);
+	cerr << "Benchmarking " << cases.size() << " caves, " << runs << " runs each on " << ThreadPool::shared().size() << " threads..." << endl;
+	for (BenchCase &bench : cases) {
+		double seconds[stageCount];
+		for (int i = 0; i < warmup; i++) {
+			runStages(bench.params, seconds);
+		}
+		for (int i = 0; i < runs; i++) {
+			runStages(bench.params, seconds);
+			double total = 0;
+			for (int s = 0; s < stageCount; s++) {
+				bench.seconds[s].push_back(seconds[s]);
+				total += seconds[s];
+			}
+			bench.seconds[stageCount].push_back(total);
+		}
+
+		//Summary of the case in ns/cell, mean +- standard deviation.
+		double cells = (double)bench.params.width * bench.params.height;
+		char line[256];
+		snprintf(line, sizeof(line), "%-14s %5dx%-5d", bench.name.c_str(), bench.params.width, bench.params.height);
+		cerr << line;
+		for (int s = 0; s <= stageCount; s++) {
+			BenchStats stats = measure(bench.seconds[s], cells);
+			snprintf(line, sizeof(line), " %8.2f +-%6.2f", stats.mean, stats.deviation);
+			cerr << line;
+		}
+		cerr << endl;
+	}
+	cerr << "Columns: ns/cell of randomise, smooth, find start, fill, remove and total." << endl;
+
+	writeJSON(json, cases, base, runs, warmup);
+	return 0;
+}
@@ -0,0 +1,273 @@
+//Headless batch cave generator.
+//Generates a number of caves from a range of seeds and parameters across every core
+//and writes each one to disk as a PBM image (occupied cells black), with an index.csv
+//recording the parameters and start cell of every cave.
+//With -T the caves are windows of unbounded chunked caves instead, which have no border
+//and skip the connectivity cleanup. This is an offline windowed generator: tiles are cached on
+//disk by their parameters, so reruns and neighbouring windows reuse them.
+//With -d the caves are 3D voxel caves, written as one PBM image per layer and recording the start voxel.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "CaveGenerator.h"
+#include "ChunkedCave.h"
+#include "VoxelCaveGenerator.h"
+#include "CellularAutomata.h"
+#include "ThreadPool.h"
+#include "MapCell.h"
+using namespace std;
+
+//Inclusive range of a parameter, parsed from "value" or "min:max".
+struct Range {
+	float min;
+	float max;
+	Range(float value) : min(value), max(value) {}
+};
+
+//Result of generating one cave.
+struct CaveRecord {
+	CaveParams params;
+	Cell startCell;
+	int startZ; //Layer of the start voxel of voxel caves.
+	int64_t startCount;
+	string file;
+	bool written;
+};
+
+void printUsage() {
+	cout << "Usage: cavegen [options]" << endl;
+	cout << "  -n COUNT        Number of caves to generate (default 1)." << endl;
+	cout << "  -o DIR          Output directory (default .)." << endl;
+	cout << "  -s SEED         Noise seed of the first cave, cave i uses SEED + i (default 1)." << endl;
+	cout << "  -w WIDTH        Cave width in cells (default 250)." << endl;
+	cout << "  -H HEIGHT       Cave height in cells (default 180)." << endl;
+	cout << "  -f MIN[:MAX]    Fill percentage (default 50)." << endl;
+	cout << "  -c MIN[:MAX]    Noise scale (default 50)." << endl;
+	cout << "  -i MIN[:MAX]    Smoothing iterations (default 10)." << endl;
+	cout << "  -O OCTAVES      Octaves of fractal noise (default 1)." << endl;
+	cout << "  -R RULE         Cellular automata B/S rule (default B5678/S45678)." << endl;
+	cout << "  -r RADIUS       Neighbourhood radius of the rule (default 1)." << endl;
+	cout << "  -l LACUNARITY   Frequency multiplier between octaves (default 2.0)." << endl;
+	cout << "  -p PERSISTENCE  Amplitude multiplier between octaves (default 0.5)." << endl;
+	cout << "  -j THREADS      Threads generating caves, 0 uses every hardware thread (default 0)." << endl;
+	cout << "  -T DIR          Writes windows of chunked caves, keeping their tiles in DIR by parameters." << endl;
+	cout << "  -x X            Window origin along the x-axis of chunked caves (default 0)." << endl;
+	cout << "  -y Y            Window origin along the y-axis of chunked caves (default 0)." << endl;
+	cout << "  -d DEPTH        Generates 3D voxel caves DEPTH layers deep, ignoring the rule (default 0, 2D caves)." << endl;
+	cout << "  -h, --help      Prints this message." << endl;
+}
+
+//Parses "value" or "min:max".
+Range parseRange(const string &s) {
+	size_t split = s.find(':');
+	Range range(stof(s.substr(0, split)));
+	if (split != string::npos) {
+		range.max = stof(s.substr(split + 1));
+	}
+	if (range.max < range.min) { swap(range.min, range.max); }
+	return range;
+}
+
+//Draws a whole number from a range, or returns its value when the range is a single value.
+float drawValue(const Range &range, mt19937_64 &generator) {
+	if (range.min == range.max) { return range.min; }
+	return uniform_int_distribution<int>((int)range.min, (int)range.max)(generator);
+}
+
+//Writes the cave as a binary PBM image with the top row of the cave first, matching the visualiser.
+void writePBMImage(ostream &out, const CaveGrid &cave) {
+	const int width = cave.getWidth();
+	const int height = cave.getHeight();
+	out << "P4\n" << width << " " << height << "\n";
+	vector<char> packed((width + 7) / 8);
+	for (int y = height - 1; y >= 0; y--) {
+		fill(packed.begin(), packed.end(), 0);
+		const uint8_t* row = cave.row(y);
+		for (int x = 0; x < width; x++) {
+			if (row[x] == Occupied) { packed[x / 8] |= (char)(0x80 >> (x % 8)); }
+		}
+		out.write(packed.data(), packed.size());
+	}
+}
+
+bool writePBM(const string &file, const CaveGrid &cave) {
+	ofstream out(file.c_str(), ios::binary);
+	if (!out) { return false; }
+	writePBMImage(out, cave);
+	return (bool)out;
+}
+
+//Writes a voxel cave as consecutive PBM images in one file, one for each layer from z = 0 upwards.
+bool writeVoxelPBM(const string &file, const VoxelGrid &voxels) {
+	ofstream out(file.c_str(), ios::binary);
+	if (!out) { return false; }
+	CaveGrid layer(voxels.getWidth(), voxels.getHeight(), Occupied);
+	for (int z = 0; z < voxels.getDepth(); z++) {
+		for (int y = 0; y < voxels.getHeight(); y++) {
+			uint8_t* row = layer.row(y);
+			for (int x = 0; x < voxels.getWidth(); x++) {
+				row[x] = voxels.get(x, y, z);
+			}
+		}
+		writePBMImage(out, layer);
+	}
+	return (bool)out;
+}
+
+int main(int argc, char* argv[]) {
+
+	int count = 1;
+	string outputDir = ".";
+	uint64_t firstSeed = 1;
+	CaveParams base;
+	Range fill(50), scale(50), iterations(10);
+	int threads = 0;
+	string tileDir; //Chunked caves when set.
+	int windowX = 0;
+	int windowY = 0;
+	int depth = 0; //Voxel caves when positive.
+
+	//Reads the options.
+	try {
+		for (int i = 1; i < argc; i++) {
+			string option = argv[i];
+			if (option == "-h" || option == "--help") { printUsage(); return 0; }
+			if (option.size() != 2 || option[0] != '-' || i + 1 >= argc) {
+				cerr << "Unknown option or missing value: " << option << "." << endl;
+				printUsage();
+				return 1;
+			}
+			string value = argv[++i];
+			switch (option[1]) {
+				case 'n': count = stoi(value); break;
+				case 'o': outputDir = value; break;
+				case 's': firstSeed = stoull(value); break;
+				case 'w': base.width = stoi(value); break;
+				case 'H': base.height = stoi(value); break;
+				case 'f': fill = parseRange(value); break;
+				case 'c': scale = parseRange(value); break;
+				case 'i': iterations = parseRange(value); break;
+				case 'O': base.octaves = stoi(value); break;
+				case 'R': base.rule = value; break;
+				case 'r': base.ruleRadius = stoi(value); break;
+				case 'l': base.lacunarity = stof(value); break;
+				case 'p': base.persistence = stof(value); break;
+				case 'j': threads = stoi(value); break;
+				case 'T': tileDir = value; break;
+				case 'x': windowX = stoi(value); break;
+				case 'y': windowY = stoi(value); break;
+				case 'd': depth = stoi(value); break;
+				default:
+					cerr << "Unknown option: " << option << "." << endl;
+					printUsage();
+					return 1;
+			}
+		}
+	}
+	catch (const exception &e) {
+		cerr << "Invalid option value." << endl;
+		printUsage();
+		return 1;
+	}
+	try {
+		CellularRule::parse(base.rule, base.ruleRadius);
+	}
+	catch (const invalid_argument &e) {
+		cerr << e.what() << "." << endl;
+		printUsage();
+		return 1;
+	}
+	if (count < 1 || base.width < 1 || base.height < 1 || depth < 0) {
+		cerr << "Count and cave dimensions must be positive." << endl;
+		return 1;
+	}
+	if (mkdir(outputDir.c_str(), 0755) != 0 && errno != EEXIST) {
+		cerr << "Unable to create output directory " << outputDir << "." << endl;
+		return 1;
+	}
+	if (!tileDir.empty() && mkdir(tileDir.c_str(), 0755) != 0 && errno != EEXIST) {
+		cerr << "Unable to create tile directory " << tileDir << "." << endl;
+		return 1;
+	}
+
+	//Each cave is generated on a single thread, with caves spread across the shared pool.
+	ThreadPool::setSharedThreads(threads);
+	ThreadPool &pool = ThreadPool::shared();
+	cout << "Generating " << count << " caves on " << pool.size() << " threads..." << endl;
+
+	vector<CaveRecord> records(count);
+	pool.run(count, [&](size_t i) {
+		CaveRecord &record = records[i];
+		record.params = base;
+		record.params.threads = 1;
+		record.params.seed = firstSeed + i;
+		record.startZ = 0;
+		if (record.params.seed == 0) { record.params.seed = 1; } //0 would select the classic noise table.
+
+		//Parameters are drawn from the cave's own seed, so every cave is reproducible on its own.
+		mt19937_64 generator(record.params.seed);
+		record.params.fillPercentage = drawValue(fill, generator);
+		record.params.noiseScale = drawValue(scale, generator);
+		record.params.smoothIterations = drawValue(iterations, generator);
+
+		ostringstream name;
+		name << "cave_" << i << ".pbm";
+		record.file = name.str();
+
+		if (depth > 0) {
+			//Each voxel cave also spreads its chunks across the pool, as caves may be large.
+			VoxelCaveGenerator voxelGenerator;
+			record.params.threads = 0;
+			voxelGenerator.generate(record.params, depth);
+			Voxel start = voxelGenerator.getStartVoxel();
+			record.startCell = Cell(start.x, start.y);
+			record.startZ = start.z;
+			record.startCount = voxelGenerator.getStartCount();
+			record.written = writeVoxelPBM(outputDir + "/" + record.file, voxelGenerator.getVoxels());
+			return;
+		}
+
+		if (!tileDir.empty()) {
+			//Window of the chunked cave, with no start cell as there is no connectivity cleanup.
+			ChunkedCave chunkedCave(record.params, tileDir, 256);
+			CaveGrid window(record.params.width, record.params.height, Occupied);
+			chunkedCave.copyRegion(windowX, windowY, window);
+			record.startCell = Cell(-1,-1);
+			record.startCount = 0;
+			record.written = writePBM(outputDir + "/" + record.file, window);
+			return;
+		}
+
+		CaveGenerator caveGenerator;
+		caveGenerator.generate(record.params);
+		record.startCell = caveGenerator.getStartCell();
+		record.startCount = caveGenerator.getStartCount();
+		record.written = writePBM(outputDir + "/" + record.file, caveGenerator.getCave());
+	});
+
+	//Index of every cave, in order.
+	ofstream index((outputDir + "/index.csv").c_str());
+	index << "index,seed,width,height,depth,fill,scale,iterations,rule,radius,octaves,lacunarity,persistence,start_x,start_y,start_z,start_count,file" << endl;
+	int failed = 0;
+	for (int i = 0; i < count; i++) {
+		const CaveRecord &record = records[i];
+		const CaveParams &p = record.params;
+		if (!record.written) {
+			cerr << "Unable to write " << record.file << "." << endl;
+			failed++;
+		}
+		index << i << "," << p.seed << "," << p.width << "," << p.height << "," << depth << "," << p.fillPercentage << "," << p.noiseScale << ","
+			<< p.smoothIterations << ",\"" << p.rule << "\"," << p.ruleRadius << "," << p.octaves << "," << p.lacunarity << "," << p.persistence << ","
+			<< record.startCell.x << "," << record.startCell.y << "," << record.startZ << "," << record.startCount << "," << record.file << endl;
+	}
+
+	cout << "Wrote " << (count - failed) << " caves to " << outputDir << "." << endl;
+	return failed == 0 ? 0 : 1;
+}
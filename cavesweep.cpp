@@ -0,0 +1,112 @@
+//Parameter sweep over cave generation.
+//Generates a cave for every combination of fill percentage, noise scale, smoothing iterations
+//and seed across every core, streaming quality metrics and stage timings of each cave to a CSV.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include "CaveSweep.h"
+#include "CellularAutomata.h"
+#include "ThreadPool.h"
+using namespace std;
+
+void printUsage() {
+	cout << "Usage: cavesweep [options]" << endl;
+	cout << "  Ranges are VALUE, MIN:MAX (step 1) or MIN:MAX:STEP." << endl;
+	cout << "  -f RANGE        Fill percentage (default 45:55)." << endl;
+	cout << "  -c RANGE        Noise scale (default 20:100:10)." << endl;
+	cout << "  -i RANGE        Smoothing iterations (default 2:20:2)." << endl;
+	cout << "  -n SEEDS        Seeds generated for each combination (default 4)." << endl;
+	cout << "  -s SEED         First noise seed, 0 uses the classic noise table with the offsets (default 1)." << endl;
+	cout << "  -x OFFSET       Noise offset along the x-axis (default 0)." << endl;
+	cout << "  -y OFFSET       Noise offset along the y-axis (default 0)." << endl;
+	cout << "  -w WIDTH        Cave width in cells (default 250)." << endl;
+	cout << "  -H HEIGHT       Cave height in cells (default 180)." << endl;
+	cout << "  -O OCTAVES      Octaves of fractal noise (default 1)." << endl;
+	cout << "  -R RULE         Cellular automata B/S rule (default B5678/S45678)." << endl;
+	cout << "  -r RADIUS       Neighbourhood radius of the rule (default 1)." << endl;
+	cout << "  -I 0|1          Incremental smoothing, 0 smooths every cell each iteration (default 1)." << endl;
+	cout << "  -o FILE         Output CSV (default standard output)." << endl;
+	cout << "  -j THREADS      Threads generating caves, 0 uses every hardware thread (default 0)." << endl;
+	cout << "  -h, --help      Prints this message." << endl;
+}
+
+int main(int argc, char* argv[]) {
+
+	CaveParams base;
+	SweepRange fill = SweepRange::parse("45:55");
+	SweepRange scale = SweepRange::parse("20:100:10");
+	SweepRange iterations = SweepRange::parse("2:20:2");
+	int seeds = 4;
+	uint64_t firstSeed = 1;
+	string outputFile;
+	int threads = 0;
+
+	//Reads the options.
+	try {
+		for (int i = 1; i < argc; i++) {
+			string option = argv[i];
+			if (option == "-h" || option == "--help") { printUsage(); return 0; }
+			if (option.size() != 2 || option[0] != '-' || i + 1 >= argc) {
+				cerr << "Unknown option or missing value: " << option << "." << endl;
+				printUsage();
+				return 1;
+			}
+			string value = argv[++i];
+			switch (option[1]) {
+				case 'f': fill = SweepRange::parse(value); break;
+				case 'c': scale = SweepRange::parse(value); break;
+				case 'i': iterations = SweepRange::parse(value); break;
+				case 'n': seeds = stoi(value); break;
+				case 's': firstSeed = stoull(value); break;
+				case 'x': base.offsetX = stof(value); break;
+				case 'y': base.offsetY = stof(value); break;
+				case 'w': base.width = stoi(value); break;
+				case 'H': base.height = stoi(value); break;
+				case 'O': base.octaves = stoi(value); break;
+				case 'R': base.rule = value; break;
+				case 'r': base.ruleRadius = stoi(value); break;
+				case 'I': base.incremental = stoi(value) != 0; break;
+				case 'o': outputFile = value; break;
+				case 'j': threads = stoi(value); break;
+				default:
+					cerr << "Unknown option: " << option << "." << endl;
+					printUsage();
+					return 1;
+			}
+		}
+	}
+	catch (const exception &e) {
+		cerr << "Invalid option value." << endl;
+		printUsage();
+		return 1;
+	}
+	try {
+		CellularRule::parse(base.rule, base.ruleRadius);
+	}
+	catch (const invalid_argument &e) {
+		cerr << e.what() << "." << endl;
+		printUsage();
+		return 1;
+	}
+	if (seeds < 1 || base.width < 1 || base.height < 1) {
+		cerr << "Seeds and cave dimensions must be positive." << endl;
+		return 1;
+	}
+
+	ofstream file;
+	if (!outputFile.empty()) {
+		file.open(outputFile.c_str());
+		if (!file) {
+			cerr << "Unable to open " << outputFile << "." << endl;
+			return 1;
+		}
+	}
+	ostream &csv = outputFile.empty() ? cout : file;
+
+	ThreadPool::setSharedThreads(threads);
+	CaveSweep sweep(base, fill, scale, iterations, firstSeed, seeds);
+	cerr << "Sweeping " << sweep.size() << " caves on " << ThreadPool::shared().size() << " threads..." << endl;
+	sweep.run(csv);
+	return 0;
+}
@@ -0,0 +1,293 @@
+//Verification of the shadowcasting field of view against the original raycasting.
+//Generates the five presets of config.txt as the visualiser does, senses from every free cell
+//(or every STRIDE-th cell along each axis) with both methods and reports the cells on which they
+//disagree, along with the time each method took.
+//With -f it instead checks the queries of the drones' frontier set against a brute-force scan.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <random>
+#include <map>
+#include <cmath>
+#include <climits>
+#include "CaveGenerator.h"
+#include "CellularAutomata.h"
+#include "FieldOfView.h"
+#include "ThreadPool.h"
+#include "Config.h"
+#include "MapCell.h"
+#include "FrontierSet.h"
+using namespace std;
+
+//Cells sensed by each method from the positions checked on one cave.
+struct CheckResult {
+	int64_t positions; //Positions sensed from.
+	int64_t differingPositions; //Positions where the methods sensed different cells.
+	int64_t raycastCells;
+	int64_t shadowcastCells;
+	int64_t raycastOnly; //Cells sensed by raycasting alone.
+	int64_t shadowcastOnly; //Cells sensed by shadowcasting alone.
+	double raycastTime; //Seconds spent sensing by each method.
+	double shadowcastTime;
+	CheckResult() : positions(0), differingPositions(0), raycastCells(0), shadowcastCells(0), raycastOnly(0), shadowcastOnly(0), raycastTime(0), shadowcastTime(0) {}
+};
+
+void printUsage() {
+	cout << "Usage: fovcheck [options]" << endl;
+	cout << "  -r RADIUS       Search radius, defaults to SEARCH_R of config.txt (default 10)." << endl;
+	cout << "  -s STRIDE       Senses from every STRIDE-th free cell along each axis (default 1)." << endl;
+	cout << "  -v COUNT        Prints up to COUNT positions where the methods differ (default 0)." << endl;
+	cout << "  -f TRIALS       Checks the frontier set over TRIALS random sets instead (default 0)." << endl;
+}
+
+//Seconds elapsed since the given time, which is then moved on to now.
+double lap(chrono::steady_clock::time_point &since) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(now - since).count();
+	since = now;
+	return seconds;
+}
+
+//Senses from the chosen free cells of a cave with both methods, comparing the cells each senses.
+CheckResult check(const CaveGrid &cave, float radius, int stride, int &printLimit) {
+	CheckResult result;
+	FieldOfView fieldOfView;
+	vector<SenseCell> raycastFree, raycastOccupied, shadowcastFree, shadowcastOccupied;
+	CaveGrid marks(cave.getWidth(), cave.getHeight(), 0); //Bit 1 sensed by raycasting, bit 2 by shadowcasting.
+
+	for (int x = 0; x < cave.getWidth(); x += stride) {
+		for (int y = 0; y < cave.getHeight(); y += stride) {
+			if (cave(x, y) != Free) { continue; }
+			chrono::steady_clock::time_point time = chrono::steady_clock::now();
+			fieldOfView.raycast(cave, x, y, radius, raycastFree, raycastOccupied);
+			result.raycastTime += lap(time);
+			fieldOfView.shadowcast(cave, x, y, radius, shadowcastFree, shadowcastOccupied);
+			result.shadowcastTime += lap(time);
+
+			//Marks the cells of both methods, then counts and clears them.
+			const vector<SenseCell>* sensed[4] = {&raycastFree, &raycastOccupied, &shadowcastFree, &shadowcastOccupied};
+			for (int k = 0; k < 4; k++) {
+				for (const SenseCell &cell : *sensed[k]) {
+					marks(cell.x, cell.y) |= (k < 2) ? 1 : 2;
+				}
+			}
+			int64_t raycastOnly = 0, shadowcastOnly = 0;
+			for (int k = 0; k < 4; k++) {
+				for (const SenseCell &cell : *sensed[k]) {
+					raycastOnly += marks(cell.x, cell.y) == 1;
+					shadowcastOnly += marks(cell.x, cell.y) == 2;
+					marks(cell.x, cell.y) = 0;
+				}
+			}
+
+			result.positions++;
+			result.raycastCells += raycastFree.size() + raycastOccupied.size();
+			result.shadowcastCells += shadowcastFree.size() + shadowcastOccupied.size();
+			result.raycastOnly += raycastOnly;
+			result.shadowcastOnly += shadowcastOnly;
+			if (raycastOnly || shadowcastOnly) {
+				result.differingPositions++;
+				if (printLimit > 0) {
+					printLimit--;
+					cout << "  (" << x << "," << y << "): " << raycastOnly << " raycast only, " << shadowcastOnly << " shadowcast only." << endl;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+//Applies random additions, updates and removals to frontier sets of random sizes, checking every
+//query against a brute-force scan of a map holding the same cells. Returns the number of mismatches.
+int checkFrontierSet(int trials, int64_t &queries) {
+	mt19937 random(1);
+	int mismatches = 0;
+	for (int trial = 0; trial < trials; trial++) {
+		int width = 20 + random() % 200;
+		int height = 20 + random() % 200;
+		FrontierSet frontiers;
+		frontiers.resize(width, height);
+		map<int,int> reference; //Timestep of each cell, in cell order.
+		int additions = 1 + trial % 3; //Chance in four of adding rather than removing a cell.
+		for (int step = 0; step < 3000; step++) {
+			int cell = random() % (width * height);
+			if ((int)(random() % 4) < additions) {
+				int timestep = step / 50 + random() % 4; //Timesteps rising as in a simulation.
+				frontiers.set(cell, timestep);
+				reference[cell] = timestep;
+			}
+			else {
+				//Mostly removes cells in the set, some of them the latest.
+				if (frontiers.size() > 0 && random() % 4) {
+					size_t k = random() % frontiers.size();
+					cell = frontiers.getY(k) * width + frontiers.getX(k);
+				}
+				frontiers.erase(cell);
+				reference.erase(cell);
+			}
+			if (step % 97 != 0) { continue; }
+			queries++;
+
+			//Membership and the latest timestep.
+			int latest = INT_MIN;
+			for (auto const& entry : reference) {
+				latest = max(latest, entry.second);
+				if (!frontiers.contains(entry.first) || frontiers.getTimestepOf(entry.first) != entry.second) { mismatches++; }
+			}
+			if (frontiers.size() != reference.size() || frontiers.getLatestTimestep() != latest) { mismatches++; }
+
+			//Nearest cells, scanning in cell order and keeping the first of equally near cells.
+			float px = random() % width + (random() % 2 ? 0.0f : 0.5f);
+			float py = random() % height;
+			auto distance = [&](int x, int y) { return (float)pow(pow(x - px, 2.0f) + pow(y - py, 2.0f), 0.5f); };
+			for (int minTimestep : {INT_MIN, latest, latest - 3}) {
+				vector<pair<float,int>> sorted;
+				for (auto const& entry : reference) {
+					if (entry.second >= minTimestep) { sorted.push_back(make_pair(distance(entry.first % width, entry.first / width), entry.first)); }
+				}
+				stable_sort(sorted.begin(), sorted.end());
+				if (frontiers.nearest(px, py, minTimestep, distance) != (sorted.empty() ? -1 : sorted[0].second)) { mismatches++; }
+				vector<int> nearest = frontiers.nearestK(px, py, 5, minTimestep, distance);
+				if (nearest.size() != min(sorted.size(), (size_t)5)) { mismatches++; continue; }
+				for (size_t i = 0; i < nearest.size(); i++) {
+					if (nearest[i] != sorted[i].second) { mismatches++; }
+				}
+			}
+
+			//Cells within a box and a radius.
+			int found = 0;
+			int expected = 0;
+			float radius = 1.0f + random() % 20;
+			frontiers.forEachInBox((int)px - 11, (int)py - 11, (int)px + 11, (int)py + 11, [&](int x, int y) {
+				found++;
+				if (!reference.count(y * width + x)) { mismatches++; }
+			});
+			frontiers.forEachInRadius(px, py, radius, [&](int x, int y) {
+				found++;
+				if (!reference.count(y * width + x) || (x - px) * (x - px) + (y - py) * (y - py) > radius * radius) { mismatches++; }
+			});
+			for (auto const& entry : reference) {
+				int x = entry.first % width;
+				int y = entry.first / width;
+				if (abs(x - (int)px) <= 11 && abs(y - (int)py) <= 11) { expected++; }
+				if ((x - px) * (x - px) + (y - py) * (y - py) <= radius * radius) { expected++; }
+			}
+			if (found != expected) { mismatches++; }
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+
+	float radius = -1;
+	int stride = 1;
+	int printLimit = 0;
+	int frontierTrials = 0;
+
+	//Reads the options.
+	try {
+		for (int i = 1; i < argc; i++) {
+			string option = argv[i];
+			if (option == "--help") { printUsage(); return 0; }
+			if (option.size() != 2 || option[0] != '-' || i + 1 >= argc) {
+				printUsage();
+				return 1;
+			}
+			string value = argv[++i];
+			switch (option[1]) {
+				case 'r': radius = stof(value); break;
+				case 's': stride = stoi(value); break;
+				case 'v': printLimit = stoi(value); break;
+				case 'f': frontierTrials = stoi(value); break;
+				default: printUsage(); return 1;
+			}
+		}
+	}
+	catch (const exception &e) {
+		cerr << "Invalid option value." << endl;
+		printUsage();
+		return 1;
+	}
+	if (frontierTrials > 0) {
+		int64_t queries = 0;
+		int mismatches = checkFrontierSet(frontierTrials, queries);
+		cout << "Frontier set: " << queries << " queries, " << mismatches << " mismatches." << endl;
+		return mismatches == 0 ? 0 : 1;
+	}
+	if (stride < 1) {
+		cerr << "Stride must be positive." << endl;
+		return 1;
+	}
+	if (!ifstream("config.txt")) {
+		cerr << "Unable to open config.txt." << endl;
+		return 1;
+	}
+
+	//Reads the presets and generation settings as the visualiser does.
+	ConfigSettings settings;
+	Config::readConfig(settings);
+	CaveParams base;
+	base.width = settings.caveW;
+	base.height = settings.caveH;
+	base.threads = settings.threads;
+	base.octaves = settings.octaves;
+	base.lacunarity = settings.lacunarity;
+	base.persistence = settings.persistence;
+	base.rule = settings.rule;
+	base.ruleRadius = settings.ruleRadius;
+	if (radius < 0) { radius = settings.searchR; }
+	try {
+		CellularRule::parse(base.rule, base.ruleRadius);
+	}
+	catch (const invalid_argument &e) {
+		cerr << e.what() << ", using B5678/S45678." << endl;
+		base.rule = "B5678/S45678";
+		base.ruleRadius = 1;
+	}
+	ThreadPool::setSharedThreads(base.threads);
+
+	cout << "Comparing raycasting and shadowcasting with radius " << radius << "..." << endl;
+	CheckResult total;
+	for (int i = 0; i < 5; i++) {
+		CaveParams params = base;
+		params.offsetX = settings.presets[i][0];
+		params.offsetY = settings.presets[i][1];
+		params.fillPercentage = settings.presets[i][2];
+		params.noiseScale = settings.presets[i][3];
+		params.smoothIterations = settings.presets[i][4];
+		params.seed = settings.seeds[i];
+		CaveGenerator generator;
+		generator.generate(params);
+
+		CheckResult result = check(generator.getCave(), radius, stride, printLimit);
+		char line[256];
+		snprintf(line, sizeof(line), "Preset %d: %lld positions, %lld differ. Cells: %lld raycast, %lld shadowcast, %lld raycast only, %lld shadowcast only. Time: %.3fs raycast, %.3fs shadowcast.",
+			i + 1, (long long)result.positions, (long long)result.differingPositions, (long long)result.raycastCells, (long long)result.shadowcastCells,
+			(long long)result.raycastOnly, (long long)result.shadowcastOnly, result.raycastTime, result.shadowcastTime);
+		cout << line << endl;
+
+		total.positions += result.positions;
+		total.differingPositions += result.differingPositions;
+		total.raycastCells += result.raycastCells;
+		total.shadowcastCells += result.shadowcastCells;
+		total.raycastOnly += result.raycastOnly;
+		total.shadowcastOnly += result.shadowcastOnly;
+		total.raycastTime += result.raycastTime;
+		total.shadowcastTime += result.shadowcastTime;
+	}
+
+	//Disagreement as a share of the cells raycasting senses.
+	char line[256];
+	snprintf(line, sizeof(line), "Total: %lld positions, %lld differ. %.3f%% of raycast cells missed, %.3f%% extra. Shadowcasting %.1fx faster.",
+		(long long)total.positions, (long long)total.differingPositions,
+		total.raycastCells ? 100.0 * total.raycastOnly / total.raycastCells : 0.0,
+		total.raycastCells ? 100.0 * total.shadowcastOnly / total.raycastCells : 0.0,
+		total.shadowcastTime > 0 ? total.raycastTime / total.shadowcastTime : 0.0);
+	cout << line << endl;
+	return 0;
+}
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -15,7 +16,7 @@
 #include <set>
 #include <vector>
 #include <random>
-#include "SimplexNoise.h" //Perlin Noise.
+#include <stdexcept>
 #include "Draw.h" //Draw functions.
 #include "Cell.h" //Cell struct.
 #include "Visuals.h" //Lighting and Materials.
@@ -23,22 +24,34 @@
 #include "Config.h" //Custom preset configurations.
 #include "MapCell.h" //Cave cell type.
 #include "CommunicationMethod.h" //Communication method enum.
+#include "CaveGrid.h" //Runtime-sized cave grid.
+#include "ThreadPool.h" //Worker threads for cave generation and drone sensing.
+#include "CaveGenerator.h" //Cave generation stages.
+#include "CellularAutomata.h" //Cellular automata rules.
+#include "CaveFile.h" //Binary cave files and cache.
+#include "CaveWorker.h" //Background cave generation.
 using namespace std;
 
 //Cave Properties.
-const int caveWidth = 250; //Number of cells making the width of the cave.
-const int caveHeight = 180; //Number of cells making the height of the cave.
-const int border = 3; //Padding of the cave border on the x-axis.
+int caveWidth = 250; //Number of cells making the width of the cave.
+int caveHeight = 180; //Number of cells making the height of the cave.
 
 //Generation Parameters.
-const int birthThreshold = 4;
-const int deathThreshold = 4;
 const float depth = -1.0f;
+int generationThreads = 0; //Threads used by the generation stages, 0 uses every hardware thread.
+int noiseOctaves = 1; //Octaves of fractal (fBm) noise, 1 uses plain simplex noise.
+float noiseLacunarity = 2.0f; //Frequency multiplier between successive octaves.
+float noisePersistence = 0.5f; //Amplitude multiplier between successive octaves.
+string caRule = "B5678/S45678"; //Cellular automata B/S rule used to smooth caves.
+int caRadius = 1; //Neighbourhood radius of the cellular automata rule.
+int caveCache = 1; //Caches generated caves on disk so they load instantly next time.
+int visibilityCache = 1; //Precomputes the cells sensed from every free cell of each cave.
+const string cacheDirectory = "cache"; //Directory of cached cave files.
 vector<vector<int>> presets; //List of cave presets obtained from the config file.
+vector<uint64_t> presetSeeds(5, 0); //Noise seed of each preset, 0 uses the classic noise table and its offsets.
 
 //Cave.
-int currentCave[caveWidth][caveHeight];
-int tempCave[caveWidth][caveHeight];
+CaveGrid currentCave;
 Cell startCell;
 vector<string> caveStats;
 
@@ -60,292 +73,83 @@ bool showPath = true;
 bool showCave = true;
 
 
-int getNeighbourCount(int x, int y) {
-	int count = 0;
-	for (size_t i = x - 1; i <= x + 1; i++) {
-		for (size_t j = y - 1; j <= y + 1; j++) {
-			if (!(i == x && j == y) && currentCave[i][j] == Free) {
-				count++;
-			}
-		}
-	}
-	return count;
-}
-
-//Performs one pass of a given ruleset of cellular automata to smooth the cave.
-void smoothCave(int iterations) {
-	for (size_t i = 0; i < iterations; i++) { //Smooth iterations.
-		for (size_t y = border; y < caveHeight - border; y++) { //For each row.
-			for (size_t x = border; x < caveWidth - border; x++) { //For each column.
-				int neighbours = getNeighbourCount(x, y);
-				if (neighbours > birthThreshold) {
-					tempCave[x][y] = Free; //Cell is born.
-				}
-				else if (neighbours < deathThreshold) {
-					tempCave[x][y] = Occupied; //Cell dies.
-				}
-				else {
-					tempCave[x][y] = currentCave[x][y]; //Maintains the cell state.
-				}
-			}
-		}
-		//Copies the contents of next cave into current cave.
-		memcpy(currentCave, tempCave, sizeof(currentCave));
-	}
-}
-
-//Generates the initial cave using Simplex noise.
-void randomiseCave(float noiseOffsetX, float noiseOffsetY, float noiseScale, float fillPercentage) {
-
-	//Iterates through each cell in the cave.
-	for (size_t y = 0; y < caveHeight; y++) { //For each column in the cave.
-		for (size_t x = 0; x < caveWidth; x++) { //For each row in the cave.
-			 //Cave border.
-			 if (x < border || x > caveWidth - border - 1 || y < border || y > caveHeight - border - 1) {
-				currentCave[x][y] = Occupied;
-				tempCave[x][y] = Occupied;
-			}
-			else {
-				//Maps each x,y coordinate to a scaled and offset coordinate.
-				float mappedX = (float)x / caveWidth * noiseScale + noiseOffsetX;
-				float mappedY = (float)y / caveHeight * noiseScale + noiseOffsetY;
-				//Gets the noise value for the coordinate.
-				float noise = SimplexNoise::noise(mappedX, mappedY);
-				//Thresholds the noise value into either a free or occupied cell.
-				float noiseThreshold = (fillPercentage / 50.0f) - 1.0f;
-				currentCave[x][y] = (noise <= noiseThreshold) ? Occupied : Free;
-			}
-		}
-	}
-}
-
-//Uses flood fill to target certain cells and modify cells in the temp and current cave accordingly.
-void floodFillReplace(int x, int y, int criteria, int currentTarget, int tempTarget) {
-	//Current cell is free.
-	if (currentCave[x][y] == currentTarget) { return; }
-
-	//Sets current cell to the target state.
-	tempCave[x][y] = tempTarget;
-
-	queue<Cell> cellQueue; //Queue of cells to be checked.
-	Cell n = Cell(x,y); //Current cell.
-	cellQueue.push(n);
-
-	while (!cellQueue.empty()) {
-		n = cellQueue.front();
-		cellQueue.pop();
-
-		//If the West cell is not part of the border and is free.
-		if (n.x-1 >= border && currentCave[n.x-1][n.y] == criteria) {
-			currentCave[n.x-1][n.y] = currentTarget;
-			tempCave[n.x-1][n.y] = tempTarget;
-			Cell west = Cell(n.x-1, n.y);
-			cellQueue.push(west);
-		}
-		//If the East cell is not part of the border and is free.
-		if (n.x+1 <= caveWidth - border - 1 && currentCave[n.x+1][n.y] == criteria) {
-			currentCave[n.x+1][n.y] = currentTarget;
-			tempCave[n.x+1][n.y] = tempTarget;
-			Cell east = Cell(n.x+1, n.y);
-			cellQueue.push(east);
-		}
-		//If the South cell is not part of the border and is free.
-		if (n.y-1 >= border && currentCave[n.x][n.y-1] == criteria) {
-			currentCave[n.x][n.y-1] = currentTarget;
-			tempCave[n.x][n.y-1] = tempTarget;
-			Cell south = Cell(n.x, n.y-1);
-			cellQueue.push(south);
-		}
-		//If the North cell is not part of the border and is free.
-		if (n.y+1 <= caveHeight - border - 1 && currentCave[n.x][n.y+1] == criteria) {
-			currentCave[n.x][n.y+1] = currentTarget;
-			tempCave[n.x][n.y+1] = tempTarget;
-			Cell north = Cell(n.x, n.y+1);
-			cellQueue.push(north);
-		}
-	}
-}
-
-//Performs a flood fill at a given position and counts how many cells are captured in the fill.
-int floodFillCount(int x, int y, int target) {
-
-	//Current cell is occupied.
-	if (tempCave[x][y] == Occupied) { return 0; }
-
-	//Sets current cell to the target state.
-	tempCave[x][y] = target;
-
-	int count = 0; //Number of cells in the same region.
-	queue<Cell> cellQueue; //Queue of cells to be checked.
-	Cell n = Cell(x,y); //Current cell.
-	cellQueue.push(n);
-
-	while (!cellQueue.empty()) {
-		n = cellQueue.front();
-		cellQueue.pop();
-
-		//If the West cell is not part of the border and is free.
-		if (n.x-1 >= border && tempCave[n.x-1][n.y] == Free) {
-			tempCave[n.x-1][n.y] = target; //Sets the west cell to target state.
-			Cell west = Cell(n.x-1, n.y);
-			cellQueue.push(west);
-			count++;
-		}
-		//If the East cell is not part of the border and is free.
-		if (n.x+1 <= caveWidth - border - 1 && tempCave[n.x+1][n.y] == Free) {
-			tempCave[n.x+1][n.y] = target; //Sets the east cell to target state.
-			Cell east = Cell(n.x+1, n.y);
-			cellQueue.push(east);
-			count++;
-		}
-		//If the South cell is not part of the border and is free.
-		if (n.y-1 >= border && tempCave[n.x][n.y-1] == Free) {
-			tempCave[n.x][n.y-1] = target; //Sets the south cell to target state.
-			Cell south = Cell(n.x, n.y-1);
-			cellQueue.push(south);
-			count++;
-		}
-		//If the North cell is not part of the border and is free.
-		if (n.y+1 <= caveHeight - border - 1 && tempCave[n.x][n.y+1] == Free) {
-			tempCave[n.x][n.y+1] = target; //Sets the north cell to target state.
-			Cell north = Cell(n.x, n.y+1);
-			cellQueue.push(north);
-			count++;
-		}
-	}
-
-	return count;
-}
-
-//Uses a series of flood fills to find an appropriate starting cell.
-Cell findStartCell() {
-
-	memcpy(tempCave, currentCave, sizeof(currentCave));
-	Cell startCell = Cell(0,0);
-	int max = 0;
-
-	//Iterates over all cells in the cave.
-	for (size_t x = border; x < caveWidth - border; x++) {
-		for (size_t y = border; y < caveHeight - border; y++) {
-			//Uses flood fill to see how many cells occupy the same free space.
-			int count = floodFillCount(x,y,Occupied);
-			if (count > max) {
-				max = count;
-				startCell.x = x;
-				startCell.y = y;
-			}
-		}
-	}
-	cout << "[Start] - (" << startCell.x << "," << startCell.y << ") - Count: " << max << "." << endl;
-	return startCell;
+//Generates caves in the background so rendering never stalls. Created after the shared pool it runs
+//on, so on exit it stops before the pool is destroyed.
+CaveWorker& caveWorker() {
+	ThreadPool::shared();
+	static CaveWorker worker(cacheDirectory);
+	return worker;
 }
 
-//Changes all inaccessible free cells to occupied cells.
-void fillInaccessibleAreas(Cell startCell) {
+//Requests a cave with no inaccessible areas, no non-border connected occupied cells and smoothed.
+//The cave is generated in the background and replaces the current cave once it is finished,
+//see applyCave. A request made before then cancels this one.
+void generateCave(float noiseOffsetX, float noiseOffsetY, float fillPercentage, float noiseScale, float smoothIt, uint64_t noiseSeed = 0) {
 
-	//Sets the temporary cave to be fully occupied.
-  for (size_t i = 0; i < caveWidth; i++) {
-		for (size_t j = 0; j < caveHeight; j++) {
-			tempCave[i][j] = Occupied;
-		}
-	}
-
-	//Converts inaccessible free cells to occupied cells.
-	floodFillReplace(startCell.x, startCell.y, Free, Occupied, Free);
-	//Copies the improved cave to the current cave structure.
-	memcpy(currentCave, tempCave, sizeof(currentCave));
-}
-
-//Removes occupied areas not connected to the cave border.
-void removeNonBorderOccupiedAreas() {
-
-	//Sets the temporary cave to be fully occupied.
-  for (size_t i = 0; i < caveWidth; i++) {
-		for (size_t j = 0; j < caveHeight; j++) {
-			tempCave[i][j] = Free;
-		}
-	}
-
-	//Iterates over cells in the cave border.
-	//Uses flood fill to find all occupied cells connected to a given border cell
-	//and dismisses occupied cells not connected to a border cell.
-	for (size_t y = border; y < caveHeight - border; y++) {
-		floodFillReplace(border - 1, y, Occupied, Free, Occupied);
-		floodFillReplace(caveWidth - border, y, Occupied, Free, Occupied);
-	}
-	for (size_t x = border; x < caveWidth - border; x++) {
-		floodFillReplace(x, border - 1, Occupied, Free, Occupied);
-		floodFillReplace(x, caveHeight - border, Occupied, Free, Occupied);
-	}
-
-	//Re-adds the borders into the cave.
-	for (size_t y = 0; y < caveHeight; y++) {
-		//Left Border.
-		for (size_t x = 0; x < border; x++) {
-			tempCave[x][y] = Occupied;
-		}
-		//Right Border.
-		for (size_t x = caveWidth - border; x < caveWidth; x++) {
-			tempCave[x][y] = Occupied;
-		}
-	}
-	for (size_t x = border; x < caveWidth - border; x++) {
-		//Bottom Border.
-		for (size_t y = 0; y < border; y++) {
-			tempCave[x][y] = Occupied;
-		}
-		//Top Border.
-		for (size_t y = caveHeight - border; y < caveHeight; y++) {
-			tempCave[x][y] = Occupied;
-		}
+	//Seed output to console.
+	cout << "[Seed] - Offset: (" << noiseOffsetX << "," << noiseOffsetY << ") - Scale: " << noiseScale << " - Fill: " << fillPercentage << "% - Iterations: " << smoothIt << endl;
+	if (noiseSeed) {
+		cout << "[Seed] - Noise Seed: " << noiseSeed << endl;
 	}
 
-	memcpy(currentCave, tempCave, sizeof(tempCave));
+	//Runs the generation stages with the current configuration.
+	CaveParams params;
+	params.width = caveWidth;
+	params.height = caveHeight;
+	params.offsetX = noiseOffsetX;
+	params.offsetY = noiseOffsetY;
+	params.fillPercentage = fillPercentage;
+	params.noiseScale = noiseScale;
+	params.smoothIterations = smoothIt;
+	params.seed = noiseSeed;
+	params.octaves = noiseOctaves;
+	params.lacunarity = noiseLacunarity;
+	params.persistence = noisePersistence;
+	params.rule = caRule;
+	params.ruleRadius = caRadius;
+	params.threads = generationThreads;
+	caveWorker().request(params, caveCache, visibilityCache ? Drone::searchRadius : -1.0f, Drone::senseMethod);
 }
 
-//Generates a cave with no inaccessible areas, no non-border connected occupied cells and smoothed.
-void generateCave(float noiseOffsetX, float noiseOffsetY, float fillPercentage, float noiseScale, float smoothIt) {
+//Swaps a finished cave in place of the current one and resets the simulation on it.
+void applyCave(CaveResult &result) {
 
 	//Updates Cave Statistics vector.
+	const CaveParams &params = result.params;
 	caveStats.clear();
-	caveStats.push_back(to_string((int)noiseOffsetX));
-	caveStats.push_back(to_string((int)noiseOffsetY));
-	caveStats.push_back(to_string((int)fillPercentage));
-	caveStats.push_back(to_string((int)noiseScale));
-	caveStats.push_back(to_string((int)smoothIt));
+	caveStats.push_back(to_string((int)params.offsetX));
+	caveStats.push_back(to_string((int)params.offsetY));
+	caveStats.push_back(to_string((int)params.fillPercentage));
+	caveStats.push_back(to_string((int)params.noiseScale));
+	caveStats.push_back(to_string(params.smoothIterations));
+	caveStats.push_back(to_string(params.seed));
 
 	Drone::droneCount = -1;
 	cameraView = -1;
 	paused = true;
 
-	//Seed output to console.
-	cout << "[Seed] - Offset: (" << noiseOffsetX << "," << noiseOffsetY << ") - Scale: " << noiseScale << " - Fill: " << fillPercentage << "% - Iterations: " << smoothIt << endl;
-
-	randomiseCave(noiseOffsetX, noiseOffsetY, noiseScale, fillPercentage); //Uses simplex noise to create a random cave.
-	smoothCave(smoothIt); //Uses cellular automata to smooth the cave cells.
-	startCell = findStartCell(); //Finds an appropraite starting location.
-	fillInaccessibleAreas(startCell); //Removes inaccessible free cells.
-	if ((int)smoothIt % 2 == 0) {
-	  removeNonBorderOccupiedAreas(); //Removes occupied cells not connected to the cave border.
+	if (result.loaded) {
+		cout << "[Cache] - Loaded " << result.cachePath << endl;
+	}
+	if (result.cacheFailed) {
+		cout << "[Cache] - Unable to write " << result.cachePath << endl;
 	}
+	swap(currentCave, result.cave);
+	startCell = result.startCell;
+	cout << "[Start] - (" << startCell.x << "," << startCell.y << ") - Count: " << result.startCount << "." << endl;
 
-	//Converts the 2D array version of the cave into a vector of vector of ints.
-	vector<vector<int>> caveVector;
-	for (size_t i = 0; i < caveWidth; i++) {
-		vector<int> caveColumn;
-		for (size_t j = 0; j < caveHeight; j++) {
-			caveColumn.push_back(currentCave[i][j]);
-		}
-		caveVector.push_back(caveColumn);
+	if (!result.visibility.empty()) {
+		cout << "[Visibility] - " << (result.visibilityLoaded ? "Loaded " : "Built ") << result.visibility.getRunCount() << " runs (" << result.visibility.getMemoryBytes() / 1024 << " KB) in " << result.visibilityTime << "s." << endl;
 	}
 
 	//Initialises the cave dimensions and contents.
-	Drone::setParams(caveWidth, caveHeight, caveVector);
+	Drone::setParams(currentCave);
+	Drone::setVisibility(result.visibility);
 }
 
 //Generates a cave from a preset read from a config file.
-void generatePresetCave(vector<int> preset) {
-	generateCave(preset[0], preset[1], preset[2], preset[3], preset[4]);
+void generatePresetCave(vector<int> preset, uint64_t noiseSeed) {
+	generateCave(preset[0], preset[1], preset[2], preset[3], preset[4], noiseSeed);
 }
 
 //Generates a cave with no inaccessible areas, no non-border connected occupied cells and smoothed.
@@ -374,11 +178,12 @@ void generateRandomCave() {
 	if (smoothIt < 2) { smoothIt = 2; }
 	if (smoothIt > 25) { smoothIt = 25; }
 
-	//Gets a random offset value for each direction for simplex noise.
-	float noiseOffsetX = rand() % 100000;
-	float noiseOffsetY = rand() % 100000;
+	//Gets a random non-zero seed for simplex noise, which is then sampled near the origin where floats are most precise.
+	mt19937_64 seedGenerator(dev());
+	uint64_t noiseSeed = 0;
+	while (noiseSeed == 0) { noiseSeed = seedGenerator(); }
 
-	generateCave(noiseOffsetX, noiseOffsetY, fillPercentage, noiseScale, smoothIt);
+	generateCave(0, 0, fillPercentage, noiseScale, smoothIt, noiseSeed);
 }
 
 //Checks for obstructions between two points in the cave.
@@ -387,13 +192,13 @@ bool lineOfSightCheck(int ax, int ay, int bx, int by) {
 	//Two points have the same x value.
 	if (ax == bx) {
 		for (size_t i = min(ay,by); i <= max(ay,by); i++) {
-			if (currentCave[ax][i] == Occupied) { return false; }
+			if (currentCave(ax,i) == Occupied) { return false; }
 		}
 	}
 	//Two points have the same y value.
 	else if (ay == by) {
 		for (size_t j = min(ax,bx); j <= max(ax,bx); j++) {
-			if (currentCave[j][ay] == Occupied) { return false; }
+			if (currentCave(j,ay) == Occupied) { return false; }
 		}
 	}
 	//Two points are not alligned by either axis.
@@ -406,7 +211,7 @@ bool lineOfSightCheck(int ax, int ay, int bx, int by) {
 			float ymin = max((int)floor(floor((min(y0,y1) * 2.0f) + 0.5f) / 2.0f), min(ay,by));
 			float ymax = min((int)ceil(floor((max(y0,y1) * 2.0f) + 0.5f) / 2.0f), max(ay,by));
 			for (size_t y = ymin; y <= ymax; y++) {
-				if (currentCave[x][y] == Occupied) { return false; }
+				if (currentCave(x,y) == Occupied) { return false; }
 			}
 		}
 	}
@@ -422,8 +227,8 @@ void communicate(int a, int b) {
 
 	//Check to see if enough time has elapsed between communications with drones a and b.
 	if (droneList[a].allowCommunication(b)) {
-		droneList[a].combineMaps(droneList[b].internalMap, droneList[b].frontierCells, b);
-		droneList[b].combineMaps(droneList[a].internalMap, droneList[a].frontierCells, a);
+		droneList[a].combineMaps(droneList[b].internalMap, b);
+		droneList[b].combineMaps(droneList[a].internalMap, a);
 	}
 }
 
@@ -491,15 +296,15 @@ void pollGlobalCommunication() {
 
 	for (size_t i = 0; i < Drone::droneCount - 1; i++) {
 		if (droneList[i+1].allowCommunication(i)) {
-			droneList[i+1].combineMaps(droneList[i].internalMap, droneList[i].frontierCells, i);
+			droneList[i+1].combineMaps(droneList[i].internalMap, i);
 		}
 	}
 	if (droneList[0].allowCommunication(Drone::droneCount - 1)) {
-		droneList[0].combineMaps(droneList[Drone::droneCount - 1].internalMap, droneList[Drone::droneCount - 1].frontierCells, Drone::droneCount - 1);
+		droneList[0].combineMaps(droneList[Drone::droneCount - 1].internalMap, Drone::droneCount - 1);
 	}
 	for (size_t i = 0; i < Drone::droneCount - 2; i++) {
 		if (droneList[i+1].allowCommunication(i)) {
-			droneList[i+1].combineMaps(droneList[i].internalMap, droneList[i].frontierCells, i);
+			droneList[i+1].combineMaps(droneList[i].internalMap, i);
 		}
 	}
 
@@ -519,8 +324,14 @@ void displayStatistics(const float* textColour) {
 
 	//Statistics.
 	Draw::drawText(xPad, windowH, textSize, "Cave Stats" , textColour);
-	Draw::drawText(xPad, windowH - yPad, statSize, ("X Offset - " + caveStats[0]).c_str(), textColour);
-	Draw::drawText(xPad, windowH - (yPad * 2), statSize, ("Y Offset - " + caveStats[1]).c_str(), textColour);
+	if (caveStats[5] != "0") {
+		Draw::drawText(xPad, windowH - yPad, statSize, ("Seed - " + caveStats[5]).c_str(), textColour);
+		Draw::drawText(xPad, windowH - (yPad * 2), statSize, ("Offset - (" + caveStats[0] + ", " + caveStats[1] + ")").c_str(), textColour);
+	}
+	else {
+		Draw::drawText(xPad, windowH - yPad, statSize, ("X Offset - " + caveStats[0]).c_str(), textColour);
+		Draw::drawText(xPad, windowH - (yPad * 2), statSize, ("Y Offset - " + caveStats[1]).c_str(), textColour);
+	}
 	Draw::drawText(xPad, windowH - (yPad * 3), statSize, ("Fill - " + caveStats[2] + "%").c_str(),  textColour);
 	Draw::drawText(xPad, windowH - (yPad * 4), statSize, ("Noise Scale - " + caveStats[3]).c_str(), textColour);
 	Draw::drawText(xPad, windowH - (yPad * 5), statSize, ("Smooth Iterations - " + caveStats[4]).c_str(), textColour);
@@ -533,6 +344,12 @@ void displayStatistics(const float* textColour) {
 	Draw::drawText(xPad, windowH - (yPad * 8), statSize, ("State - " + state).c_str(), textColour);
 	Draw::drawText(xPad, windowH - (yPad * 9), statSize, ("No. Drones - " + drone).c_str(), textColour);
 	Draw::drawText(xPad, windowH - (yPad * 10), statSize, ("Communication - " + comm).c_str(), textColour);
+	if (caveWorker().isBusy()) {
+		int stageCount = caveWorker().getStageCount();
+		int stage = min(caveWorker().getStage() + 1, stageCount);
+		string progress = string(caveWorker().getStageName()) + " (" + to_string(stage) + "/" + to_string(stageCount) + ")";
+		Draw::drawText(xPad, windowH - (yPad * 11), statSize, ("Generating - " + progress).c_str(), textColour);
+	}
 
 	//Toggles.
 	string caveState = (showCave) ? "ON" : "OFF";
@@ -596,14 +413,14 @@ void renderCaveNormal() {
 	//For each cell in the cave.
 	for (size_t i = 0; i < caveWidth; i++) {
 		for (size_t j = 0; j < caveHeight; j++) {
-			if (currentCave[i][j] == Occupied) {
+			if (currentCave(i,j) == Occupied) {
 				glPushMatrix();
 				//Translate to cell position.
 				glTranslatef((float)i, (float)j, 0);
 
 				//Main face.
 				glColor4fv(caveFaceColour);
-				if (currentCave[i][j] == Occupied) {
+				if (currentCave(i,j) == Occupied) {
 					glBegin(GL_TRIANGLE_STRIP);
 					glNormal3f(0.0f, 0.0f, 1.0f);
 					glVertex3f(-0.5f, -0.5f, 0);
@@ -615,7 +432,7 @@ void renderCaveNormal() {
 
 				glColor4fv(caveDepthColour);
 				//Left Depth face.
-				if (i - 1 >= 0 && currentCave[i-1][j] == Free) {
+				if (i > 0 && currentCave(i-1,j) == Free) {
 					glBegin(GL_QUAD_STRIP);
 					glNormal3f(-1.0f, 0.0f, 0.0f);
 					glVertex3f(-0.5f, -0.5f, 0);
@@ -625,7 +442,7 @@ void renderCaveNormal() {
 					glEnd();
 				}
 				//Right Depth face.
-				if (i + 1 < caveWidth && currentCave[i+1][j] == Free) {
+				if (i + 1 < caveWidth && currentCave(i+1,j) == Free) {
 					glBegin(GL_QUAD_STRIP);
 					glNormal3f(1.0f, 0.0f, 0.0f);
 					glVertex3f(0.5f, -0.5f, 0);
@@ -635,7 +452,7 @@ void renderCaveNormal() {
 					glEnd();
 				}
 				//Bottom Depth face.
-				if (j - 1 >= 0 && currentCave[i][j-1] == Free) {
+				if (j > 0 && currentCave(i,j-1) == Free) {
 					glBegin(GL_QUAD_STRIP);
 					glNormal3f(0.0f, -1.0f, 0.0f);
 					glVertex3f(-0.5f, -0.5f, 0);
@@ -645,7 +462,7 @@ void renderCaveNormal() {
 					glEnd();
 				}
 				//Top Depth face.
-				if (j + 1 < caveHeight && currentCave[i][j+1] == Free) {
+				if (j + 1 < caveHeight && currentCave(i,j+1) == Free) {
 					glBegin(GL_QUAD_STRIP);
 					glNormal3f(0.0f, 1.0f, 0.0f);
 					glVertex3f(-0.5f, 0.5f, 0);
@@ -710,10 +527,10 @@ void renderCaveSmooth() {
 			glColor4fv(caveFaceColour);
 
 			//Gets a 4-bit value based on occupied cells in the block for use by the marching squares algorithm.
-			int tr = currentCave[i+1][j+1] == Occupied;
-			int tl = currentCave[i][j+1] == Occupied;
-			int bl = currentCave[i][j] == Occupied;
-			int br = currentCave[i+1][j] == Occupied;
+			int tr = currentCave(i+1,j+1) == Occupied;
+			int tl = currentCave(i,j+1) == Occupied;
+			int bl = currentCave(i,j) == Occupied;
+			int br = currentCave(i+1,j) == Occupied;
 
 			int vertexInd = (tl << 3) + (tr << 2) + (br << 1) + bl;
 
@@ -1060,17 +877,23 @@ void drawDronePath() {
 
 //Idle loop. Processes drone functions every timestep.
 void idle() {
+	//Swaps in a cave finished in the background, redrawing while one is generated to show its progress.
+	CaveResult result;
+	if (caveWorker().takeResult(result)) {
+		applyCave(result);
+		glutPostRedisplay();
+	}
+	else if (paused && caveWorker().isBusy()) {
+		usleep(2500);
+		glutPostRedisplay();
+	}
 	if (!paused) {
 		//2500 Microsecond pause.
 		usleep(2500);
 		//Communication between drones.
 		(commMethod == Local) ? pollLocalCommunication() : pollGlobalCommunication();
 		//Processes each drone.
-		for (size_t i = 0; i < Drone::droneCount; i++) {
-			if (!droneList[i].complete) {
-				droneList[i].process();
-			}
-		}
+		Drone::processAll(droneList);
 		glutPostRedisplay();
 	}
 }
@@ -1222,23 +1045,23 @@ void specialKeyInput(int key, int x, int y) {
 		//Cave Generation Presets.
 		case GLUT_KEY_F1: //Jagged cave.
 			cout << "[Preset 1]" << endl;
-			generatePresetCave(presets[0]);
+			generatePresetCave(presets[0], presetSeeds[0]);
 			break;
 		case GLUT_KEY_F2:
 			cout << "[Preset 2]" << endl;
-			generatePresetCave(presets[1]);
+			generatePresetCave(presets[1], presetSeeds[1]);
 			break;
 		case GLUT_KEY_F3:
 			cout << "[Preset 3]" << endl;
-			generatePresetCave(presets[2]);
+			generatePresetCave(presets[2], presetSeeds[2]);
 			break;
 		case GLUT_KEY_F4:
 			cout << "[Preset 4]" << endl;
-			generatePresetCave(presets[3]);
+			generatePresetCave(presets[3], presetSeeds[3]);
 			break;
 		case GLUT_KEY_F5:
 			cout << "[Preset 5]" << endl;
-			generatePresetCave(presets[4]);
+			generatePresetCave(presets[4], presetSeeds[4]);
 			break;
 	}
 	glutPostRedisplay();
@@ -1263,19 +1086,39 @@ void init() {
 	glShadeModel(GL_SMOOTH);
 
 	//Reads config file for default values.
-	vector<int> presetSing;
-	presetSing.push_back(0);
-	presetSing.push_back(0);
-	presetSing.push_back(50);
-	presetSing.push_back(50);
-	presetSing.push_back(10);
-	presets.push_back(presetSing);
-	presets.push_back(presetSing);
-	presets.push_back(presetSing);
-	presets.push_back(presetSing);
-	presets.push_back(presetSing);
-
-	Config::readConfig(presets, commMethod, Drone::searchRadius, Drone::communicationRadius);
+	ConfigSettings settings;
+	Config::readConfig(settings);
+	presets = settings.presets;
+	presetSeeds = settings.seeds;
+	commMethod = settings.method;
+	Drone::senseMethod = settings.sensing;
+	Drone::searchRadius = settings.searchR;
+	Drone::communicationRadius = settings.commR;
+	caveWidth = settings.caveW;
+	caveHeight = settings.caveH;
+	generationThreads = settings.threads;
+	noiseOctaves = settings.octaves;
+	noiseLacunarity = settings.lacunarity;
+	noisePersistence = settings.persistence;
+	caveCache = settings.cache;
+	visibilityCache = settings.visibility;
+	caRule = settings.rule;
+	caRadius = settings.ruleRadius;
+	ThreadPool::setSharedThreads(generationThreads);
+
+	//Falls back to the default rule if the configured rule cannot be used.
+	try {
+		CellularRule::parse(caRule, caRadius);
+	}
+	catch (const invalid_argument &e) {
+		cerr << e.what() << ", using B5678/S45678." << endl;
+		caRule = "B5678/S45678";
+		caRadius = 1;
+	}
+
+	//Centres the overview camera on the cave.
+	cameraPanX = caveWidth / 2.0f;
+	cameraPanY = caveHeight / 2.0f;
 }
 
 int main(int argc, char* argv[]) {
@@ -1298,10 +1141,14 @@ int main(int argc, char* argv[]) {
 	glutDisplayFunc(display);
 	glutIdleFunc(idle);
 
-	//Cave Generation.
+	init();
+
+	//Cave Generation. The first cave is waited for, so there is always a cave to draw.
 	generateRandomCave();
+	CaveResult firstCave;
+	caveWorker().waitForResult(firstCave);
+	applyCave(firstCave);
 
-	init();
 	glutMainLoop();
 	return 0;
 }